@@ -1,8 +1,89 @@
 ﻿#include "dir_scan.h"
+#include "minipack_trace.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <mutex>
 #include <system_error>
+#include <thread>
 
-bool collect_files_from_directory(const std::string &dir, std::vector<std::pair<std::string, std::string>> &out, std::string &err)
+namespace {
+
+struct PendingDir
+{
+    std::filesystem::path path;
+    std::string prefix; // stored-name prefix, empty or ending with '/'
+};
+
+class ScanQueue
+{
+public:
+    void push(PendingDir d)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_dirs.push_back(std::move(d));
+            ++m_outstanding;
+        }
+        m_cv.notify_one();
+    }
+
+    // Blocks until a directory is available; returns false once every queued
+    // directory has been fully processed.
+    bool pop(PendingDir &d)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [&] { return !m_dirs.empty() || m_outstanding == 0; });
+        if (m_dirs.empty()) return false;
+        d = std::move(m_dirs.front());
+        m_dirs.pop_front();
+        return true;
+    }
+
+    void done()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_outstanding == 0) m_cv.notify_all();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<PendingDir> m_dirs;
+    std::size_t m_outstanding = 0;
+};
+
+void scan_one(const PendingDir &dir, ScanQueue &queue, std::vector<ScannedFile> &found)
+{
+    MiniPackTraceScope trace("scan_directory", "scan", dir.prefix);
+    std::error_code ec;
+    std::filesystem::directory_iterator it(dir.path, std::filesystem::directory_options::skip_permission_denied, ec);
+    if (ec) return;
+    for (; it != std::filesystem::directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        const auto &entry = *it;
+        std::string name = entry.path().filename().generic_string();
+        std::error_code ec2;
+        const bool is_link = entry.is_symlink(ec2);
+        if (!is_link && entry.is_directory(ec2) && !ec2) {
+            queue.push(PendingDir{entry.path(), dir.prefix + name + "/"});
+            continue;
+        }
+        if (!entry.is_regular_file(ec2) || ec2) continue;
+        ScannedFile f;
+        f.size = entry.file_size(ec2);
+        f.size_known = !ec2;
+        if (ec2) f.size = 0;
+        f.disk_path = entry.path().string();
+        f.stored_name = dir.prefix + name;
+        found.push_back(std::move(f));
+    }
+}
+
+} // namespace
+
+bool scan_directory(const std::string &dir, std::vector<ScannedFile> &out, std::string &err, unsigned threads)
 {
     out.clear();
     std::error_code ec;
@@ -10,24 +91,33 @@ bool collect_files_from_directory(const std::string &dir, std::vector<std::pair<
     if (!std::filesystem::exists(root, ec)) { err = "Directory does not exist: " + dir; return false; }
     if (!std::filesystem::is_directory(root, ec)) { err = "Not a directory: " + dir; return false; }
 
-    for (auto it = std::filesystem::recursive_directory_iterator(root, std::filesystem::directory_options::skip_permission_denied, ec);
-         it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
-        if (ec) continue;
-        const auto &entry = *it;
-        if (!entry.is_regular_file(ec) || ec) continue;
-        std::string disk_path = entry.path().string();
-        std::string stored;
-        std::error_code ec2;
-        try {
-            stored = std::filesystem::relative(entry.path(), root, ec2).generic_string();
-        } catch (...) {
-            ec2 = std::make_error_code(std::errc::io_error);
-        }
-        if (ec2) {
-            stored = entry.path().filename().generic_string();
+    if (threads == 0) threads = std::max(1u, std::min(std::thread::hardware_concurrency(), 16u));
+
+    ScanQueue queue;
+    queue.push(PendingDir{root, std::string()});
+
+    std::vector<std::vector<ScannedFile>> per_worker(threads);
+    auto worker = [&](unsigned id) {
+        PendingDir d;
+        while (queue.pop(d)) {
+            scan_one(d, queue, per_worker[id]);
+            queue.done();
         }
-        out.emplace_back(disk_path, stored);
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; ++i) pool.emplace_back(worker, i);
+    worker(0);
+    for (auto &t : pool) t.join();
+
+    std::size_t total = 0;
+    for (const auto &v : per_worker) total += v.size();
+    out.reserve(total);
+    for (auto &v : per_worker) {
+        for (auto &f : v) out.push_back(std::move(f));
     }
+    std::sort(out.begin(), out.end(), [](const ScannedFile &a, const ScannedFile &b) { return a.stored_name < b.stored_name; });
 
     if (out.empty()) {
         err = "No files found in directory: " + dir;
@@ -35,3 +125,14 @@ bool collect_files_from_directory(const std::string &dir, std::vector<std::pair<
     }
     return true;
 }
+
+bool collect_files_from_directory(const std::string &dir, std::vector<std::pair<std::string, std::string>> &out, std::string &err)
+{
+    MiniPackTraceScope trace("collect_files_from_directory", "scan", dir);
+    out.clear();
+    std::vector<ScannedFile> files;
+    if (!scan_directory(dir, files, err)) return false;
+    out.reserve(files.size());
+    for (auto &f : files) out.emplace_back(std::move(f.disk_path), std::move(f.stored_name));
+    return true;
+}
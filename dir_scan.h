@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -8,3 +9,18 @@
 // relative to 'dir' using forward slashes.
 // Returns true on success. On failure, returns false and sets 'err'.
 bool collect_files_from_directory(const std::string &dir, std::vector<std::pair<std::string, std::string>> &out, std::string &err);
+
+struct ScannedFile
+{
+    std::string disk_path;
+    std::string stored_name; // relative to the scanned root, forward slashes
+    std::uint64_t size = 0;
+    bool size_known = false; // false if the file could not be stat'ed (size is then 0)
+};
+
+// Parallel variant: subdirectories are fanned out to 'threads' workers
+// (0 = hardware concurrency). Relative names are built by string prefix
+// rather than std::filesystem::relative, sizes are collected in the same
+// pass (see ScannedFile::size_known), and results are sorted by stored_name so the order is deterministic.
+// Like the recursive scan, symlinked directories are not followed.
+bool scan_directory(const std::string &dir, std::vector<ScannedFile> &out, std::string &err, unsigned threads = 0);
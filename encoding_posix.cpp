@@ -1,122 +1,179 @@
 ﻿#if !defined(_WIN32)
 #include "encoding.h"
 #include "utf_conv.h"
-#include <vector>
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
-#include <fstream>
-#include <iterator>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #ifdef HAVE_ICONV
 #include <iconv.h>
 #endif
 
-bool read_text_file_as_utf8(const std::string &path, std::string &out)
+namespace {
+
+// Read the whole file into 'buf' with a single allocation for regular files.
+// The buffer is sized from fstat (+1 so growth during the read is noticed).
+// A leading UTF-8 BOM is consumed rather than stored ('utf8_bom' reports it), so
+// UTF-8 input needs no copy afterwards. 'buf' is only replaced on success.
+bool read_whole_file(const std::string &path, std::string &buf, bool &utf8_bom)
 {
-    // Read raw bytes
-    std::ifstream in(path, std::ios::binary);
-    if (!in) return false;
-    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
-    if (data.size() >= 3 && static_cast<unsigned char>(data[0]) == 0xEF && static_cast<unsigned char>(data[1]) == 0xBB && static_cast<unsigned char>(data[2]) == 0xBF) {
-        out.assign(data.data() + 3, data.size() - 3);
-        return true;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) { ::close(fd); return false; }
+
+    std::size_t capacity = 64 * 1024;
+    if (S_ISREG(st.st_mode)) {
+        capacity = static_cast<std::size_t>(st.st_size) + 1;
+#if defined(POSIX_FADV_SEQUENTIAL)
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
     }
-    if (data.size() >= 4 && static_cast<unsigned char>(data[0]) == 0xFF && static_cast<unsigned char>(data[1]) == 0xFE && static_cast<unsigned char>(data[2]) == 0x00 && static_cast<unsigned char>(data[3]) == 0x00) {
-        // UTF-32 LE BOM
-        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data() + 4);
-        size_t sz = data.size() - 4;
-#ifdef HAVE_ICONV
-        iconv_t cd = iconv_open("UTF-8", "UTF-32LE");
-        if (cd != (iconv_t)-1) {
-            size_t in_bytes_left = sz;
-            char *in_ptr = const_cast<char*>(reinterpret_cast<const char*>(bytes));
-            std::vector<char> outbuf((in_bytes_left + 1) * 4);
-            char *out_ptr = outbuf.data();
-            size_t out_bytes_left = outbuf.size();
-            size_t res = iconv(cd, &in_ptr, &in_bytes_left, &out_ptr, &out_bytes_left);
-            iconv_close(cd);
-            if (res != (size_t)-1) {
-                out.assign(outbuf.data(), outbuf.size() - out_bytes_left);
-                return true;
-            }
+
+    // The first bytes are read on their own so a BOM never has to be cut out of the buffer
+    char head[3];
+    std::size_t head_size = 0;
+    while (head_size < sizeof(head)) {
+        ssize_t n = ::read(fd, head + head_size, sizeof(head) - head_size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            return false;
         }
-#endif
-        if (utf32le_bytes_to_utf8(bytes, sz, out)) return true;
-        return false;
+        if (n == 0) break;
+        head_size += static_cast<std::size_t>(n);
     }
-    if (data.size() >= 4 && static_cast<unsigned char>(data[0]) == 0x00 && static_cast<unsigned char>(data[1]) == 0x00 && static_cast<unsigned char>(data[2]) == 0xFE && static_cast<unsigned char>(data[3]) == 0xFF) {
-        // UTF-32 BE BOM
-        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data() + 4);
-        size_t sz = data.size() - 4;
-#ifdef HAVE_ICONV
-        iconv_t cd = iconv_open("UTF-8", "UTF-32BE");
-        if (cd != (iconv_t)-1) {
-            size_t in_bytes_left = sz;
-            char *in_ptr = const_cast<char*>(reinterpret_cast<const char*>(bytes));
-            std::vector<char> outbuf((in_bytes_left + 1) * 4);
-            char *out_ptr = outbuf.data();
-            size_t out_bytes_left = outbuf.size();
-            size_t res = iconv(cd, &in_ptr, &in_bytes_left, &out_ptr, &out_bytes_left);
-            iconv_close(cd);
-            if (res != (size_t)-1) {
-                out.assign(outbuf.data(), outbuf.size() - out_bytes_left);
-                return true;
-            }
+    utf8_bom = head_size == 3 && static_cast<unsigned char>(head[0]) == 0xEF
+            && static_cast<unsigned char>(head[1]) == 0xBB && static_cast<unsigned char>(head[2]) == 0xBF;
+
+    std::string data;
+    data.resize(std::max(capacity, head_size));
+    std::size_t used = 0;
+    if (!utf8_bom) {
+        std::memcpy(&data[0], head, head_size);
+        used = head_size;
+    }
+    for (;;) {
+        if (used == data.size()) data.resize(data.size() * 2);
+        ssize_t n = ::read(fd, &data[used], data.size() - used);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            return false;
         }
-#endif
-        if (utf32be_bytes_to_utf8(bytes, sz, out)) return true;
-        return false;
+        if (n == 0) break;
+        used += static_cast<std::size_t>(n);
     }
-    if (data.size() >= 2 && (unsigned char)data[0] == 0xFF && (unsigned char)data[1] == 0xFE) {
-        // UTF-16 LE
-        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data() + 2);
-        size_t sz = data.size() - 2;
+    ::close(fd);
+    data.resize(used);
+    buf = std::move(data);
+    return true;
+}
+
 #ifdef HAVE_ICONV
-        iconv_t cd = iconv_open("UTF-8", "UTF-16LE");
-        if (cd != (iconv_t)-1) {
-            size_t in_bytes_left = sz;
-            char *in_ptr = const_cast<char*>(reinterpret_cast<const char*>(bytes));
-            std::vector<char> outbuf((in_bytes_left + 1) * 2);
-            char *out_ptr = outbuf.data();
-            size_t out_bytes_left = outbuf.size();
-            size_t res = iconv(cd, &in_ptr, &in_bytes_left, &out_ptr, &out_bytes_left);
-            iconv_close(cd);
-            if (res != (size_t)-1) {
-                out.assign(outbuf.data(), outbuf.size() - out_bytes_left);
-                return true;
-            }
-            // fallthrough to manual converter
+// One cached conversion descriptor per source encoding and thread
+iconv_t cached_iconv(const char *from)
+{
+    struct Slot { const char *from; iconv_t cd; };
+    struct Cache {
+        Slot slots[4] = {{nullptr, (iconv_t)-1}, {nullptr, (iconv_t)-1}, {nullptr, (iconv_t)-1}, {nullptr, (iconv_t)-1}};
+        ~Cache() {
+            for (auto &s : slots)
+                if (s.cd != (iconv_t)-1) iconv_close(s.cd);
+        }
+    };
+    thread_local Cache cache;
+    for (auto &s : cache.slots) {
+        if (s.from && std::strcmp(s.from, from) == 0) return s.cd;
+        if (!s.from) {
+            s.from = from;
+            s.cd = iconv_open("UTF-8", from);
+            return s.cd;
         }
-#endif
-        if (utf16le_bytes_to_utf8(bytes, sz, out)) return true;
-        return false;
     }
-    if (data.size() >= 2 && (unsigned char)data[0] == 0xFE && (unsigned char)data[1] == 0xFF) {
-        // UTF-16 BE
-        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data() + 2);
-        size_t sz = data.size() - 2;
-#ifdef HAVE_ICONV
-        iconv_t cd = iconv_open("UTF-8", "UTF-16BE");
-        if (cd != (iconv_t)-1) {
-            size_t in_bytes_left = sz;
-            char *in_ptr = const_cast<char*>(reinterpret_cast<const char*>(bytes));
-            std::vector<char> outbuf((in_bytes_left + 1) * 2);
-            char *out_ptr = outbuf.data();
-            size_t out_bytes_left = outbuf.size();
-            size_t res = iconv(cd, &in_ptr, &in_bytes_left, &out_ptr, &out_bytes_left);
-            iconv_close(cd);
-            if (res != (size_t)-1) {
-                out.assign(outbuf.data(), outbuf.size() - out_bytes_left);
-                return true;
-            }
-            // fallthrough to manual converter
+    return (iconv_t)-1;
+}
+
+// Convert with iconv, growing 'out' in fixed chunks that iconv writes into directly
+bool iconv_to_utf8(const char *from, const uint8_t *bytes, size_t sz, std::string &out)
+{
+    iconv_t cd = cached_iconv(from);
+    if (cd == (iconv_t)-1) return false;
+    iconv(cd, nullptr, nullptr, nullptr, nullptr); // reset shift state
+
+    constexpr size_t kChunk = 256 * 1024;
+    char *in_ptr = const_cast<char*>(reinterpret_cast<const char*>(bytes));
+    size_t in_bytes_left = sz;
+    size_t used = 0;
+    out.clear();
+    out.reserve(sz);
+    while (in_bytes_left > 0) {
+        out.resize(used + kChunk);
+        char *out_ptr = &out[used];
+        size_t out_bytes_left = kChunk;
+        size_t res = iconv(cd, &in_ptr, &in_bytes_left, &out_ptr, &out_bytes_left);
+        used += kChunk - out_bytes_left;
+        if (res == (size_t)-1 && errno != E2BIG) {
+            out.clear();
+            return false;
         }
+    }
+    out.resize(used);
+    return true;
+}
+#endif
+
+bool decode_to_utf8(const char *iconv_name, bool (*manual)(const uint8_t*, size_t, std::string&), const uint8_t *bytes, size_t sz, std::string &out)
+{
+#ifdef HAVE_ICONV
+    if (iconv_to_utf8(iconv_name, bytes, sz, out)) return true;
+    // fallthrough to manual converter
+#else
+    (void)iconv_name;
 #endif
-        if (utf16be_bytes_to_utf8(bytes, sz, out)) return true;
-        return false;
+    return manual(bytes, sz, out);
+}
+
+} // namespace
+
+bool read_text_file_as_utf8(const std::string &path, std::string &out)
+{
+    // Read raw bytes into a local buffer; UTF-8 input is moved into 'out' without a copy
+    std::string raw;
+    bool utf8_bom = false;
+    if (!read_whole_file(path, raw, utf8_bom)) return false;
+    if (utf8_bom) {
+        out = std::move(raw);
+        return true;
+    }
+
+    const size_t n = raw.size();
+    const unsigned char *d = reinterpret_cast<const unsigned char*>(raw.data());
+    const char *iconv_name = nullptr;
+    bool (*manual)(const uint8_t*, size_t, std::string&) = nullptr;
+    size_t bom = 0;
+    if (n >= 4 && d[0] == 0xFF && d[1] == 0xFE && d[2] == 0x00 && d[3] == 0x00) {
+        iconv_name = "UTF-32LE"; manual = utf32le_bytes_to_utf8; bom = 4;
+    } else if (n >= 4 && d[0] == 0x00 && d[1] == 0x00 && d[2] == 0xFE && d[3] == 0xFF) {
+        iconv_name = "UTF-32BE"; manual = utf32be_bytes_to_utf8; bom = 4;
+    } else if (n >= 2 && d[0] == 0xFF && d[1] == 0xFE) {
+        iconv_name = "UTF-16LE"; manual = utf16le_bytes_to_utf8; bom = 2;
+    } else if (n >= 2 && d[0] == 0xFE && d[1] == 0xFF) {
+        iconv_name = "UTF-16BE"; manual = utf16be_bytes_to_utf8; bom = 2;
+    } else {
+        // No BOM -> assume UTF-8 on POSIX
+        out = std::move(raw);
+        return true;
     }
 
-    // No BOM -> assume UTF-8 on POSIX
-    out.assign(data.data(), data.size());
+    std::string converted;
+    if (!decode_to_utf8(iconv_name, manual, reinterpret_cast<const uint8_t*>(raw.data()) + bom, raw.size() - bom, converted)) return false;
+    out = std::move(converted);
     return true;
 }
 #endif
@@ -1,34 +1,71 @@
 ﻿#include "file_list_reader.h"
 
-#include <sstream>
 #include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <utility>
 
 #include "encoding.h"
+#include "minipack_trace.h"
 
-static std::string trim(const std::string &s)
+static std::string_view trim(std::string_view s)
 {
     auto b = s.find_first_not_of(" \t\r\n");
-    if (b == std::string::npos) return "";
+    if (b == std::string_view::npos) return {};
     auto e = s.find_last_not_of(" \t\r\n");
     return s.substr(b, e - b + 1);
 }
 
+// Call fn(disk_path, stored_name) for every entry line; stored_name is empty
+// when the line has no TAB-separated second field.
+template<typename Fn>
+static void for_each_list_line(std::string_view content, Fn &&fn)
+{
+    const char *p = content.data();
+    const char *end = p + content.size();
+    while (p < end) {
+        const char *nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char *line_end = nl ? nl : end;
+        std::string_view line = trim(std::string_view(p, static_cast<size_t>(line_end - p)));
+        p = nl ? nl + 1 : end;
+
+        if (line.empty() || line[0] == '#') continue; // empty or comment
+
+        const size_t tab = line.find('\t');
+        if (tab == std::string_view::npos) {
+            fn(line, std::string_view());
+        } else {
+            std::string_view disk = trim(line.substr(0, tab));
+            if (disk.empty()) continue;
+            fn(disk, trim(line.substr(tab + 1)));
+        }
+    }
+}
+
+size_t parse_file_list(std::string_view content, std::vector<std::pair<std::string, std::string>> &out_pairs)
+{
+    const size_t before = out_pairs.size();
+    out_pairs.reserve(before + static_cast<size_t>(std::count(content.begin(), content.end(), '\n')) + 1);
+    for_each_list_line(content, [&](std::string_view disk, std::string_view stored) {
+        out_pairs.emplace_back(std::piecewise_construct,
+                               std::forward_as_tuple(disk),
+                               std::forward_as_tuple(stored.empty() ? disk : stored));
+    });
+    return out_pairs.size() - before;
+}
+
 bool read_file_list(const std::string &list_path, std::vector<std::string> &out_files, std::string &err)
 {
+    MiniPackTraceScope trace("read_file_list", "input", list_path);
     std::string list_content_utf8;
     if (!read_text_file_as_utf8(list_path, list_content_utf8)) {
         err = "Failed to read or decode list file: " + list_path;
         return false;
     }
 
-    std::istringstream iss(list_content_utf8);
-    std::string line;
-    while (std::getline(iss, line)) {
-        std::string s = trim(line);
-        if (s.empty()) continue;
-        if (!s.empty() && s[0] == '#') continue; // comment
-        out_files.push_back(s);
-    }
+    for_each_list_line(list_content_utf8, [&](std::string_view disk, std::string_view) {
+        out_files.emplace_back(disk);
+    });
 
     if (out_files.empty()) {
         err = "No files listed in " + list_path;
@@ -36,3 +73,19 @@ bool read_file_list(const std::string &list_path, std::vector<std::string> &out_
     }
     return true;
 }
+
+bool read_file_list_pairs(const std::string &list_path, std::vector<std::pair<std::string, std::string>> &out_pairs, std::string &err)
+{
+    MiniPackTraceScope trace("read_file_list", "input", list_path);
+    std::string list_content_utf8;
+    if (!read_text_file_as_utf8(list_path, list_content_utf8)) {
+        err = "Failed to read or decode list file: " + list_path;
+        return false;
+    }
+
+    if (parse_file_list(list_content_utf8, out_pairs) == 0) {
+        err = "No files listed in " + list_path;
+        return false;
+    }
+    return true;
+}
@@ -1,8 +1,20 @@
 ﻿#pragma once
 
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 // Read a list of file paths (UTF-8 text file). Returns true on success and fills out_files.
 // On error, returns false and sets err to a message.
 bool read_file_list(const std::string &list_path, std::vector<std::string> &out_files, std::string &err);
+
+// Read a file list into (disk_path, stored_name) pairs. Each line is either
+// "disk_path" (stored under the same name) or "disk_path<TAB>stored_name".
+// Empty lines and lines starting with '#' are skipped; surrounding spaces,
+// tabs and CR are trimmed from each field.
+bool read_file_list_pairs(const std::string &list_path, std::vector<std::pair<std::string, std::string>> &out_pairs, std::string &err);
+
+// Parse already-decoded list content with the same rules as read_file_list_pairs.
+// Appends to out_pairs; returns the number of entries appended.
+size_t parse_file_list(std::string_view content, std::vector<std::pair<std::string, std::string>> &out_pairs);
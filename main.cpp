@@ -14,63 +14,153 @@
 #include "mini_pack_builder_file.h"
 #include "file_list_reader.h"
 #include "dir_scan.h"
+#include "minipack_trace.h"
+#include "minipack_args.h"
 
 int main(int argc, char **argv) {
     if (argc < 3) {
-        std::cout << "Usage: " << argv[0] << " <list.txt|directory> <output.pack> [--index-only|-i]\n";
+        std::cout << "Usage: " << argv[0] << " <list.txt|directory> <output.pack> [--index-only|-i] [--front-coded|-f] [--align N] [--arena] [--volume-size N[K|M|G]] [--jobs|-j N] [--async-write] [--trace out.json] [--verbose|-v]\n";
         return 1;
     }
 
     std::string list_path = argv[1];
     std::string out_path = argv[2];
     bool index_only = false;
-    if (argc >= 4) {
-        std::string flag = argv[3];
+    bool verbose = false;
+    bool front_coded = false;
+    std::uint32_t alignment = 1;
+    bool arena = false;
+    std::string trace_path;
+    std::uint64_t volume_size = 0;
+    unsigned jobs = 0;
+    bool async_write = false;
+    for (int i = 3; i < argc; ++i) {
+        std::string flag = argv[i];
         if (flag == "--index-only" || flag == "-i") index_only = true;
+        else if (flag == "--front-coded" || flag == "-f") front_coded = true;
+        else if (flag == "--align" && i + 1 < argc) {
+            std::uint64_t value = 0;
+            if (!minipack_args::parse_u64(argv[++i], value) || value > std::numeric_limits<std::uint32_t>::max()) {
+                std::cerr << "Invalid --align value: " << argv[i] << "\n";
+                return 1;
+            }
+            alignment = static_cast<std::uint32_t>(value);
+        }
+        else if (flag == "--arena") arena = true;
+        else if (flag == "--trace" && i + 1 < argc) trace_path = argv[++i];
+        else if (flag == "--volume-size" && i + 1 < argc) {
+            if (!minipack_args::parse_size(argv[++i], volume_size)) {
+                std::cerr << "Invalid --volume-size value: " << argv[i] << "\n";
+                return 1;
+            }
+        }
+        else if ((flag == "--jobs" || flag == "-j") && i + 1 < argc) {
+            std::uint64_t value = 0;
+            if (!minipack_args::parse_u64(argv[++i], value) || value > std::numeric_limits<unsigned>::max()) {
+                std::cerr << "Invalid --jobs value: " << argv[i] << "\n";
+                return 1;
+            }
+            jobs = static_cast<unsigned>(value);
+        }
+        else if (flag == "--async-write") async_write = true;
+        else if (flag == "--verbose" || flag == "-v") verbose = true;
     }
 
-    // Use a vector of pairs: {disk_path, stored_name_in_pack}
-    std::vector<std::pair<std::string, std::string>> file_pairs;
+    // Chrome trace-event JSON of the build phases, written when the build finishes
+    MiniPackTrace trace;
+    if (!trace_path.empty()) minipack_set_trace(&trace);
+
+    // Files to pack: disk path, stored name in the pack and, for directory scans, size
+    std::vector<ScannedFile> files;
     std::string err;
 
     // If the input path is a directory, enumerate files recursively and store
     // them with relative paths as their stored names inside the pack.
-    if (!collect_files_from_directory(list_path, file_pairs, err)) {
+    if (!scan_directory(list_path, files, err)) {
         // If collection failed, fall back to treating list_path as a file list
-        // (collect_files_from_directory sets err on failure; but read_file_list may be the real intention)
-        file_pairs.clear();
-        std::vector<std::string> files;
-        if (!read_file_list(list_path, files, err)) {
+        // (scan_directory sets err on failure; but read_file_list may be the real intention)
+        // Lines may be "disk_path" or "disk_path<TAB>stored_name".
+        std::vector<std::pair<std::string, std::string>> file_pairs;
+        if (!read_file_list_pairs(list_path, file_pairs, err)) {
             std::cerr << err << "\n";
             return 1;
         }
-        for (const auto &f : files) file_pairs.emplace_back(f, f);
+        files.clear();
+        files.reserve(file_pairs.size());
+        for (auto &p : file_pairs) files.push_back(ScannedFile{std::move(p.first), std::move(p.second)});
     }
 
     MiniPackBuilder builder;
-    // Add files to builder (this will load files into memory)
-    for (const auto &p : file_pairs) {
-        if (!add_file_to_builder(builder, p.first, p.second, err)) {
+    builder.set_front_coded_names(front_coded);
+    if (arena) builder.enable_arena();
+    builder.reserve(files.size());
+    if (!builder.set_entry_alignment(alignment)) {
+        std::cerr << "Invalid --align value (power of two up to 4096): " << alignment << "\n";
+        return 1;
+    }
+    if (!builder.set_volume_size(index_only ? 0 : volume_size)) {
+        std::cerr << "Invalid --volume-size value (below 4G, at most 4294967295 bytes): " << volume_size << "\n";
+        return 1;
+    }
+    // Add files to builder. Serial builds load them into memory now; with --jobs or
+    // --async-write they are read while the pack is written, reusing the scanned sizes.
+    const bool deferred = jobs > 0 || async_write;
+    for (const auto &f : files) {
+        const bool ok = !deferred ? add_file_to_builder(builder, f.disk_path, f.stored_name, err)
+                      : f.size_known ? add_file_to_builder_deferred(builder, f.disk_path, f.stored_name, f.size, err)
+                                     : add_file_to_builder_deferred(builder, f.disk_path, f.stored_name, err);
+        if (!ok) {
             std::cerr << err << "\n";
             return 1;
         }
     }
 
     // Build pack by writing directly to output file using create_file_writer
-    auto writer = create_file_writer(out_path);
-    if (!writer) {
-        std::cerr << "Failed to open output file: " << out_path << "\n";
-        return 1;
+    MiniPackWriterStats write_stats{};
+    MiniPackFileWriterOptions writer_options;
+    writer_options.stats = &write_stats;
+    if (verbose) writer_options.log = [](const std::string &message) { std::cout << message << "\n"; };
+    MiniPackBuildResult result{};
+    if (builder.volume_size() > 0) {
+        // Index to out_path, data to out_path.001, .002, ... written concurrently
+        if (!build_pack_volume_files(builder, out_path, writer_options, result, err, jobs)) {
+            std::cerr << err << "\n";
+            return 1;
+        }
+    } else {
+        auto writer = create_file_writer(out_path, writer_options);
+        if (!writer) {
+            std::cerr << "Failed to open output file: " << out_path << "\n";
+            return 1;
+        }
+        // Disk writes on a background thread while the next entries are loaded
+        if (async_write && jobs == 0) writer = create_async_writer(std::move(writer));
+        // Workers write each run of entries at its final offset
+        const bool ok = jobs > 0 && !index_only ? builder.build_pack_parallel(writer.get(), result, err, jobs)
+                                                : builder.build_pack(writer.get(), index_only, result, err);
+        if (!ok) {
+            std::cerr << err << "\n";
+            return 1;
+        }
     }
 
-    MiniPackBuildResult result{};
-    if (!builder.build_pack(writer.get(), index_only, result, err)) {
-        std::cerr << err << "\n";
-        return 1;
+    if (!trace_path.empty()) {
+        minipack_set_trace(nullptr);
+        if (!trace.write_json(trace_path, err)) {
+            std::cerr << err << "\n";
+            return 1;
+        }
+    }
+
+    if (verbose) {
+        std::cout << "Wrote " << write_stats.bytes_written << " bytes in " << write_stats.os_write_calls << " write calls ("
+                  << write_stats.bytes_per_second() / (1024.0 * 1024.0) << " MiB/s)\n";
     }
 
     if (index_only)
         std::cout << "Wrote index (info block) for " << result.file_count << " files to " << out_path << " (info_size=" << result.info_size << " bytes, data=" << result.total_data_size << " bytes, data not written)\n";
+    else if (result.volume_count > 0)
+        std::cout << "Packed " << result.file_count << " files into " << out_path << " + " << result.volume_count << " volumes (info_size=" << result.info_size << " bytes, data=" << result.total_data_size << " bytes)\n";
     else
         std::cout << "Packed " << result.file_count << " files into " << out_path << " (info_size=" << result.info_size << " bytes, data=" << result.total_data_size << " bytes)\n";
 
@@ -1,20 +1,37 @@
 ﻿#include "mini_pack_builder.h"
 #include "minipack_format.h"
+#include "minipack_name_table.h"
+#include "minipack_parallel.h"
+#include "minipack_stats.h"
+#include "minipack_trace.h"
 
+#include <algorithm>
 #include <limits>
+#include <string_view>
 #include <vector>
 #include <memory>
-#include <iostream>
 #include <cstring>
+#include <new>
 
 MiniPackBuilder::MiniPackBuilder() = default;
 
-void MiniPackBuilder::clear() { m_entries.clear(); }
+void MiniPackBuilder::clear()
+{
+    m_entries.clear();
+    if (m_arena) m_arena->clear();
+}
 
 bool MiniPackBuilder::empty() const { return m_entries.empty(); }
 
 std::size_t MiniPackBuilder::file_count() const { return m_entries.size(); }
 
+bool MiniPackBuilder::enable_arena(std::size_t chunk_size)
+{
+    if (!m_entries.empty()) return false;
+    m_arena = std::make_unique<ChunkedByteArena>(chunk_size);
+    return true;
+}
+
 bool MiniPackBuilder::add_entry_from_buffer(const std::string &name, const std::vector<std::uint8_t> &data, std::string &err)
 {
     if (name.empty()) { err = "Failed to convert name: empty"; return false; }
@@ -22,10 +39,17 @@ bool MiniPackBuilder::add_entry_from_buffer(const std::string &name, const std::
         err = "Buffer too large for MiniPack entry";
         return false;
     }
+    return add_entry_copy(name, data.data(), data.size(), err);
+}
 
-    std::cout<<"MiniPackBuilder::add_entry_from_buffer("<<name<<", data of size "<<data.size()<<")"<<std::endl;
-
-    return add_entry_internal(name, data, err);
+bool MiniPackBuilder::add_entry_from_buffer(const std::string &name, std::vector<std::uint8_t> &&data, std::string &err)
+{
+    if (name.empty()) { err = "Failed to convert name: empty"; return false; }
+    if (data.size() > std::numeric_limits<std::uint32_t>::max()) {
+        err = "Buffer too large for MiniPack entry";
+        return false;
+    }
+    return add_entry_internal(name, std::move(data), err);
 }
 
 bool MiniPackBuilder::add_entry_from_buffer(const std::string &name, const void *data, std::uint32_t size, std::string &err)
@@ -33,141 +57,439 @@ bool MiniPackBuilder::add_entry_from_buffer(const std::string &name, const void
     if (name.empty()) { err = "Failed to convert name: empty"; return false; }
     if (size == 0) {
         // allow empty entry
-        std::vector<std::uint8_t> empty;
-        return add_entry_internal(name, std::move(empty), err);
+        return add_entry_copy(name, nullptr, 0, err);
     }
     if (data == nullptr) { err = "Data pointer is null"; return false; }
+    return add_entry_copy(name, static_cast<const std::uint8_t*>(data), size, err);
+}
 
-    std::cout<<"MiniPackBuilder::add_entry_from_buffer("<<name<<", raw pointer size "<<size<<")"<<std::endl;
+bool MiniPackBuilder::add_entry_borrowed(const std::string &name, std::span<const std::uint8_t> data, std::string &err)
+{
+    if (name.empty()) { err = "Failed to convert name: empty"; return false; }
+    if (data.size() > std::numeric_limits<std::uint32_t>::max()) {
+        err = "Buffer too large for MiniPack entry";
+        return false;
+    }
+    if (data.data() == nullptr && !data.empty()) { err = "Data pointer is null"; return false; }
 
-    // Copy into owned vector
-    std::vector<std::uint8_t> buf;
-    buf.resize(size);
-    std::memcpy(buf.data(), data, size);
-    return add_entry_internal(name, std::move(buf), err);
+    Entry entry;
+    set_entry_name(entry, name);
+    entry.borrowed = data.empty() ? nullptr : data.data();
+    entry.size = data.size();
+    m_entries.push_back(std::move(entry));
+    return true;
+}
+
+bool MiniPackBuilder::add_entry_from_source(const std::string &name, std::uint64_t size, EntrySource source, std::string &err)
+{
+    if (name.empty()) { err = "Entry name cannot be empty"; return false; }
+    if (size > std::numeric_limits<std::uint32_t>::max()) { err = "Entry size exceeds limit"; return false; }
+    if (!source && size > 0) { err = "Entry source is null"; return false; }
+
+    Entry entry;
+    set_entry_name(entry, name);
+    entry.size = static_cast<std::size_t>(size);
+    if (size > 0) entry.source = std::move(source);
+    m_entries.push_back(std::move(entry));
+    return true;
+}
+
+bool MiniPackBuilder::fill_entry(const Entry &entry, std::uint8_t *dst, std::string &err) const
+{
+    if (!entry.source) {
+        std::memcpy(dst, entry.bytes(), entry.size);
+        return true;
+    }
+    if (entry.source(dst, entry.size, err)) return true;
+    err = "Failed to produce entry " + std::string(entry.name()) + (err.empty() ? std::string() : ": " + err);
+    return false;
 }
 
 bool MiniPackBuilder::build_index(std::vector<std::uint8_t> &header, std::vector<std::uint32_t> &offsets, MiniPackBuildResult &result, std::string &err) const
 {
+    std::vector<std::uint32_t> volumes;
+    return build_index(header, offsets, volumes, result, err);
+}
+
+bool MiniPackBuilder::build_index(std::vector<std::uint8_t> &header, std::vector<std::uint32_t> &offsets, std::vector<std::uint32_t> &volumes, MiniPackBuildResult &result, std::string &err) const
+{
+    MiniPackTraceScope trace("build_index", "build");
     if (m_entries.empty()) {
         err = "No entries added to MiniPack";
         return false;
     }
 
-    std::vector<std::uint8_t> info;
-    info.reserve(16 * m_entries.size());
+    // The info block is assembled in place after the magic and a size placeholder
+    std::vector<std::uint8_t> &info = header;
+    info.clear();
+    info.reserve(minipack_format::kInfoBlockOffset + 16 * m_entries.size());
+    info.resize(minipack_format::kInfoBlockOffset);
+    std::memcpy(info.data(), minipack_format::kMagic, minipack_format::kMagicSize);
+
+    const std::uint32_t file_count = static_cast<std::uint32_t>(m_entries.size());
+
+    // Order of the index tables. Front coding only pays off on sorted names, so
+    // those tables list entries by name; the data area keeps insertion order and
+    // the explicit offsets tie the two together.
+    std::vector<std::uint32_t> order(m_entries.size());
+    for (std::uint32_t i = 0; i < file_count; ++i) order[i] = i;
+    if (m_front_coded_names) {
+        std::stable_sort(order.begin(), order.end(), [this](std::uint32_t a, std::uint32_t b) {
+            return m_entries[a].name() < m_entries[b].name();
+        });
+    }
 
-    minipack_format::append_u32_le(info, minipack_format::kVersion);
-    minipack_format::append_u32_le(info, static_cast<std::uint32_t>(m_entries.size()));
+    const bool volume_mode = m_volume_size > 0;
+    if (m_front_coded_names || volume_mode) {
+        minipack_format::append_u32_le(info, minipack_format::kVersion2);
+        minipack_format::append_u32_le(info, file_count);
+        minipack_format::append_u32_le(info, (m_front_coded_names ? minipack_format::kFlagFrontCodedNames : 0)
+                                           | (volume_mode ? minipack_format::kFlagVolumes : 0));
+    } else {
+        minipack_format::append_u32_le(info, minipack_format::kVersion);
+        minipack_format::append_u32_le(info, file_count);
+    }
 
-    // 1) Write all name lengths (uint8, not including the trailing NUL)
-    std::vector<std::uint8_t> name_lengths;
-    name_lengths.reserve(m_entries.size());
-    for (const auto &entry : m_entries) {
-        if (entry.name.size() > 0xFF) {
-            err = "Filename too long (max 255 bytes): " + entry.name;
-            return false;
+    if (m_front_coded_names) {
+        // 1+2) Names as front-coded blocks; lengths are varints, so no 255-byte limit
+        minipack_format::append_front_coded_names(info, file_count, [&](std::uint32_t i) {
+            return m_entries[order[i]].name();
+        });
+    } else {
+        // 1) Write all name lengths (uint8, not including the trailing NUL)
+        for (const auto &entry : m_entries) {
+            if (entry.name().size() > 0xFF) {
+                err = "Filename too long (max 255 bytes, use front-coded names for longer): " + std::string(entry.name());
+                return false;
+            }
+            info.push_back(static_cast<std::uint8_t>(entry.name().size()));
         }
-        name_lengths.push_back(static_cast<std::uint8_t>(entry.name.size()));
-    }
-    // append lengths block
-    info.insert(info.end(), name_lengths.begin(), name_lengths.end());
 
-    // 2) Write all names as raw bytes, each followed by a NUL terminator (\0)
-    for (const auto &entry : m_entries) {
-        if (!entry.name.empty())
-            info.insert(info.end(), entry.name.begin(), entry.name.end());
-        info.push_back(0); // NUL terminator
+        // 2) Write all names as raw bytes, each followed by a NUL terminator (\0)
+        for (const auto &entry : m_entries) {
+            const std::string_view name = entry.name();
+            info.insert(info.end(), name.begin(), name.end());
+            info.push_back(0); // NUL terminator
+        }
     }
 
-    // 3) Compute offsets and total sizes
+    // 3) Compute offsets and total sizes. With an entry alignment the info block is
+    // zero-padded so the data area starts aligned, and each entry is placed on an
+    // aligned offset (readers ignore bytes after the size table).
+    // In volume mode offsets are relative to the entry's volume file, which starts
+    // a new volume whenever the next entry would cross the size cap.
+    const std::uint64_t align = m_entry_alignment;
+    const std::uint64_t tables_end = info.size() + 2 * minipack_format::kU32Size * m_entries.size();
+    const std::size_t info_padding = volume_mode ? 0 : static_cast<std::size_t>((align - tables_end % align) % align);
+
     offsets.clear();
     offsets.reserve(m_entries.size());
+    volumes.clear();
+    if (volume_mode) volumes.reserve(m_entries.size());
     std::uint64_t current_offset = 0;
     std::uint64_t total_data_size = 0;
+    std::uint32_t volume = 1;
 
     for (const auto &entry : m_entries) {
-        total_data_size += entry.data.size();
-        if (total_data_size > std::numeric_limits<std::uint32_t>::max()) {
+        if (volume_mode) {
+            if (entry.size == 0) {
+                offsets.push_back(0);
+                volumes.push_back(0);
+                continue;
+            }
+            if (entry.size > m_volume_size) {
+                err = "Entry larger than the volume size: " + std::string(entry.name()) + " (" + std::to_string(entry.size) + " bytes)";
+                return false;
+            }
+            const std::uint64_t aligned = (current_offset + align - 1) / align * align;
+            if (current_offset > 0 && aligned + entry.size > m_volume_size) {
+                total_data_size += current_offset;
+                current_offset = 0;
+                ++volume;
+            } else {
+                current_offset = aligned;
+            }
+            volumes.push_back(volume);
+        } else if (entry.size != 0) {
+            current_offset = (current_offset + align - 1) / align * align;
+        }
+        if (current_offset + entry.size > std::numeric_limits<std::uint32_t>::max()) {
             err = "Total data too large for 32-bit offsets/sizes";
             return false;
         }
-    }
-
-    for (const auto &entry : m_entries) {
         offsets.push_back(static_cast<std::uint32_t>(current_offset));
-        current_offset += entry.data.size();
+        current_offset += entry.size;
     }
+    total_data_size += current_offset;
 
     // 4) Append all data_offsets for all files, then all data_sizes for all files
     for (std::size_t i = 0; i < m_entries.size(); ++i) {
-        minipack_format::append_u32_le(info, offsets[i]);
+        minipack_format::append_u32_le(info, offsets[order[i]]);
     }
     for (std::size_t i = 0; i < m_entries.size(); ++i) {
-        minipack_format::append_u32_le(info, static_cast<std::uint32_t>(m_entries[i].data.size()));
+        minipack_format::append_u32_le(info, static_cast<std::uint32_t>(m_entries[order[i]].size));
     }
+    if (volume_mode) {
+        minipack_format::append_u32_le(info, volume);
+        for (std::size_t i = 0; i < m_entries.size(); ++i) minipack_format::append_u32_le(info, volumes[order[i]]);
+    }
+
+    info.resize(info.size() + info_padding, 0);
 
-    if (info.size() > std::numeric_limits<std::uint32_t>::max()) {
+    const std::size_t info_size = info.size() - minipack_format::kInfoBlockOffset;
+    if (info_size > std::numeric_limits<std::uint32_t>::max()) {
         err = "Info block too large";
         return false;
     }
+    minipack_format::write_u32_le(&header[minipack_format::kInfoSizeOffset], static_cast<std::uint32_t>(info_size));
 
-    header.clear();
-    header.insert(header.end(), std::begin(minipack_format::kMagic), std::end(minipack_format::kMagic));
-    minipack_format::append_u32_le(header, static_cast<std::uint32_t>(info.size()));
-    header.insert(header.end(), info.begin(), info.end());
-
-    result.info_size = info.size();
+    result.info_size = info_size;
     result.total_data_size = total_data_size;
     result.file_count = m_entries.size();
+    result.volume_count = volume_mode ? volume : 0;
     return true;
 }
 
-bool MiniPackBuilder::build_pack(MiniPackWriter *writer, bool index_only, MiniPackBuildResult &result, std::string &err) const
+bool MiniPackBuilder::build_pack(MiniPackWriter *writer, bool index_only, MiniPackBuildResult &result, std::string &err, MiniPackStats *stats) const
+{
+    MiniPackTraceScope trace("build_pack", "build");
+    const auto start = MiniPackStats::start();
+    std::uint64_t total_size = 0;
+    const bool ok = write_pack(writer, index_only, result, total_size, err);
+    if (stats) stats->record_build(start, total_size, ok);
+    return ok;
+}
+
+bool MiniPackBuilder::write_pack(MiniPackWriter *writer, bool index_only, MiniPackBuildResult &result, std::uint64_t &total_size, std::string &err) const
 {
     if (!writer) { err = "Writer is null"; return false; }
+    if (m_volume_size > 0 && !index_only) { err = "Volume size set; write the pack with build_pack_volumes"; return false; }
 
     std::vector<std::uint8_t> header;
     std::vector<std::uint32_t> offsets;
     if (!build_index(header, offsets, result, err)) return false;
 
+    total_size = header.size() + (index_only ? 0 : result.total_data_size);
+    if (!writer->reserve(total_size, err)) return false;
+
     if (!writer->write(header.data(), header.size(), err)) return false;
-    if (index_only) return true;
+    if (index_only) return writer->flush(err);
+    return write_entry_data(writer, offsets, {}, 0, err);
+}
 
-    for (const auto &entry : m_entries) {
-        if (!entry.data.empty()) {
-            if (!writer->write(entry.data.data(), entry.data.size(), err)) return false;
+bool MiniPackBuilder::write_entry_data(MiniPackWriter *writer, const std::vector<std::uint32_t> &offsets, const std::vector<std::uint32_t> &volumes, std::uint32_t volume, std::string &err) const
+{
+    // Hand the entries to the writer as gathered slices straight from their storage
+    // (owned vectors, borrowed buffers or arena chunks). Gaps only exist with an
+    // entry alignment and are filled from a zero block. Deferred entries are produced
+    // into a scratch buffer and sent out at once, since the next one reuses it.
+    constexpr std::size_t kSliceBatch = 4096;
+    std::vector<std::uint8_t> zeros(m_entry_alignment > 1 ? m_entry_alignment : 0, 0);
+    std::vector<std::uint8_t> scratch;
+    std::vector<MiniPackIoSlice> slices;
+    slices.reserve(std::min<std::size_t>(2 * m_entries.size(), kSliceBatch));
+    std::uint64_t written = 0;
+    for (std::size_t i = 0; i < m_entries.size(); ++i) {
+        const auto &entry = m_entries[i];
+        if (entry.size == 0 || (!volumes.empty() && volumes[i] != volume)) continue;
+        if (offsets[i] > written) slices.push_back(MiniPackIoSlice{zeros.data(), static_cast<std::size_t>(offsets[i] - written)});
+        const std::uint8_t *bytes = entry.bytes();
+        if (entry.source) {
+            scratch.resize(entry.size);
+            if (!fill_entry(entry, scratch.data(), err)) return false;
+            bytes = scratch.data();
+        }
+        slices.push_back(MiniPackIoSlice{bytes, entry.size});
+        written = offsets[i] + entry.size;
+        if (slices.size() >= kSliceBatch || entry.source) {
+            if (!writer->write_gather(slices.data(), slices.size(), err)) return false;
+            slices.clear();
         }
     }
+    if (!slices.empty() && !writer->write_gather(slices.data(), slices.size(), err)) return false;
+
+    return writer->flush(err);
+}
 
+bool MiniPackBuilder::build_pack_parallel(MiniPackWriter *writer, MiniPackBuildResult &result, std::string &err, unsigned threads, MiniPackStats *stats) const
+{
+    if (writer && !writer->supports_write_at()) return build_pack(writer, false, result, err, stats);
+    MiniPackTraceScope trace("build_pack_parallel", "build");
+    const auto start = MiniPackStats::start();
+    std::uint64_t total_size = 0;
+    const bool ok = write_pack_parallel(writer, result, total_size, err, threads);
+    if (stats) stats->record_build(start, total_size, ok);
+    return ok;
+}
+
+bool MiniPackBuilder::write_pack_parallel(MiniPackWriter *writer, MiniPackBuildResult &result, std::uint64_t &total_size, std::string &err, unsigned threads) const
+{
+    if (!writer) { err = "Writer is null"; return false; }
+    if (m_volume_size > 0) { err = "Volume size set; write the pack with build_pack_volumes"; return false; }
+
+    std::vector<std::uint8_t> header;
+    std::vector<std::uint32_t> offsets;
+    if (!build_index(header, offsets, result, err)) return false;
+
+    total_size = header.size() + result.total_data_size;
+    if (!writer->reserve(total_size, err)) return false;
+    if (!writer->write_at(0, header.data(), header.size(), err)) return false;
+
+    // Split the data area into runs of consecutive entries of about kRunBytes each,
+    // so small files share one positional write. Larger entries form a run alone.
+    // Each run starts where the previous one ended, so alignment gaps are written
+    // as zeros rather than left to the writer.
+    constexpr std::uint64_t kRunBytes = 4 * 1024 * 1024;
+    struct Run { std::uint64_t begin; std::size_t first, last; };
+    std::vector<Run> runs;
+    std::uint64_t end = 0;
+    for (std::size_t i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].size == 0) continue;
+        const std::uint64_t entry_end = std::uint64_t{offsets[i]} + m_entries[i].size;
+        if (!runs.empty() && entry_end - runs.back().begin <= kRunBytes) runs.back().last = i;
+        else runs.push_back(Run{end, i, i});
+        end = entry_end;
+    }
+
+    // Each worker fills runs into its own buffer
+    const std::uint64_t data_start = header.size();
+    std::vector<std::vector<std::uint8_t>> buffers(minipack_parallel::worker_count(runs.size(), threads));
+    const bool ok = minipack_parallel::for_each_claimed(runs.size(), threads, err, [&](unsigned worker, std::size_t r, std::string &local_err) {
+        const Run run = runs[r];
+        const std::uint64_t run_start = run.begin;
+        const std::size_t run_size = static_cast<std::size_t>(offsets[run.last] + m_entries[run.last].size - run_start);
+        if (run.first == run.last && !m_entries[run.first].source && offsets[run.first] == run_start) {
+            // A lone stored entry with no gap before it goes out straight from its storage
+            return writer->write_at(data_start + run_start, m_entries[run.first].bytes(), run_size, local_err);
+        }
+        MiniPackTraceScope run_trace("write_run", "build", std::to_string(run.last - run.first + 1) + " entries");
+        std::vector<std::uint8_t> &buffer = buffers[worker];
+        buffer.assign(run_size, 0);
+        for (std::size_t i = run.first; i <= run.last; ++i)
+            if (m_entries[i].size > 0 && !fill_entry(m_entries[i], buffer.data() + (offsets[i] - run_start), local_err)) return false;
+        return writer->write_at(data_start + run_start, buffer.data(), run_size, local_err);
+    });
+    return ok && writer->flush(err);
+}
+
+bool MiniPackBuilder::build_pack_image(MiniPackImage &image, bool index_only, MiniPackBuildResult &result, std::string &err, MiniPackStats *stats) const
+{
+    MiniPackTraceScope trace("build_pack_image", "build");
+    const auto start = MiniPackStats::start();
+    const bool ok = write_pack_image(image, index_only, result, err);
+    if (stats) stats->record_build(start, ok ? image.size() : 0, ok);
+    return ok;
+}
+
+bool MiniPackBuilder::build_pack_volumes(MiniPackWriter *index_writer, const VolumeWriterFactory &open_volume, MiniPackBuildResult &result, std::string &err, unsigned threads, MiniPackStats *stats) const
+{
+    MiniPackTraceScope trace("build_pack_volumes", "build");
+    const auto start = MiniPackStats::start();
+    auto done = [&](bool ok, std::uint64_t bytes) {
+        if (stats) stats->record_build(start, bytes, ok);
+        return ok;
+    };
+    if (!index_writer) { err = "Writer is null"; return done(false, 0); }
+    if (m_volume_size == 0) { err = "No volume size set"; return done(false, 0); }
+
+    std::vector<std::uint8_t> header;
+    std::vector<std::uint32_t> offsets, volumes;
+    if (!build_index(header, offsets, volumes, result, err)) return done(false, 0);
+    if (!index_writer->reserve(header.size(), err) || !index_writer->write(header.data(), header.size(), err) || !index_writer->flush(err))
+        return done(false, 0);
+
+    std::vector<std::uint64_t> volume_sizes(result.volume_count + 1, 0);
+    for (std::size_t i = 0; i < m_entries.size(); ++i)
+        volume_sizes[volumes[i]] = std::max<std::uint64_t>(volume_sizes[volumes[i]], std::uint64_t{offsets[i]} + m_entries[i].size);
+
+    const bool ok = minipack_parallel::for_each_claimed(result.volume_count, threads, err, [&](unsigned, std::size_t item, std::string &local_err) {
+        const std::uint32_t v = static_cast<std::uint32_t>(item + 1);
+        MiniPackTraceScope volume_trace("write_volume", "build", std::to_string(v));
+        std::unique_ptr<MiniPackWriter> writer = open_volume(v, local_err);
+        bool written = writer != nullptr && writer->reserve(volume_sizes[v], local_err)
+                    && write_entry_data(writer.get(), offsets, volumes, v, local_err);
+        writer.reset();
+        if (!written) local_err = "Volume " + std::to_string(v) + ": " + local_err;
+        return written;
+    });
+    return done(ok, header.size() + result.total_data_size);
+}
+
+bool MiniPackBuilder::write_pack_image(MiniPackImage &image, bool index_only, MiniPackBuildResult &result, std::string &err) const
+{
+    if (m_volume_size > 0 && !index_only) { err = "Volume size set; write the pack with build_pack_volumes"; return false; }
+    std::vector<std::uint8_t> header;
+    std::vector<std::uint32_t> offsets;
+    if (!build_index(header, offsets, result, err)) return false;
+
+    const std::uint64_t total_size = header.size() + (index_only ? 0 : result.total_data_size);
+    if (total_size > std::numeric_limits<std::size_t>::max()) {
+        err = "Pack image too large for memory";
+        return false;
+    }
+
+    std::unique_ptr<std::uint8_t[]> data;
+    try {
+        data.reset(new std::uint8_t[static_cast<std::size_t>(total_size)]);
+    } catch (const std::bad_alloc &) {
+        err = "Failed to allocate pack image of " + std::to_string(total_size) + " bytes";
+        return false;
+    }
+
+    std::memcpy(data.get(), header.data(), header.size());
+    if (!index_only) {
+        std::uint8_t *dst = data.get() + header.size();
+        std::uint64_t written = 0;
+        for (std::size_t i = 0; i < m_entries.size(); ++i) {
+            const auto &entry = m_entries[i];
+            if (entry.size == 0) continue;
+            if (offsets[i] > written) std::memset(dst + written, 0, static_cast<std::size_t>(offsets[i] - written));
+            if (!fill_entry(entry, dst + offsets[i], err)) return false;
+            written = offsets[i] + entry.size;
+        }
+    }
+
+    image.m_data = std::move(data);
+    image.m_size = static_cast<std::size_t>(total_size);
     return true;
 }
 
-bool MiniPackBuilder::add_entry_internal(std::string name, std::vector<std::uint8_t> data, std::string &err)
+bool MiniPackBuilder::add_entry_internal(const std::string &name, std::vector<std::uint8_t> &&data, std::string &err)
 {
     if (name.empty()) { err = "Entry name cannot be empty"; return false; }
     if (data.size() > std::numeric_limits<std::uint32_t>::max()) { err = "Entry size exceeds limit"; return false; }
-    m_entries.push_back(Entry{std::move(name), std::move(data)});
+    Entry entry;
+    set_entry_name(entry, name);
+    entry.size = data.size();
+    entry.owned = std::move(data);
+    m_entries.push_back(std::move(entry));
     return true;
 }
 
-bool MiniPackBuilder::add_entry_internal(std::string name, const void *data, std::uint32_t size, std::string &err)
+bool MiniPackBuilder::add_entry_copy(const std::string &name, const std::uint8_t *data, std::size_t size, std::string &err)
 {
-    if (name.empty()) { err = "Entry name cannot be empty"; return false; }
-    if (size > std::numeric_limits<std::uint32_t>::max()) { err = "Entry size exceeds limit"; return false; }
-    if (size == 0) {
-        m_entries.push_back(Entry{std::move(name), {}});
-        return true;
-    }
-    if (data == nullptr) { err = "Data pointer is null"; return false; }
+    if (!m_arena) return add_entry_internal(name, std::vector<std::uint8_t>(data, data + size), err);
 
-    std::vector<std::uint8_t> buf;
-    buf.resize(size);
-    std::memcpy(buf.data(), data, size);
-    m_entries.push_back(Entry{std::move(name), std::move(buf)});
+    // Arena mode: the payload is appended to the current chunk, no per-entry allocation
+    if (name.empty()) { err = "Entry name cannot be empty"; return false; }
+    Entry entry;
+    set_entry_name(entry, name);
+    entry.borrowed = size ? m_arena->append(data, size) : nullptr;
+    entry.size = size;
+    m_entries.push_back(std::move(entry));
     return true;
 }
 
+void MiniPackBuilder::set_entry_name(Entry &entry, const std::string &name)
+{
+    if (m_arena) {
+        entry.arena_name = reinterpret_cast<const char*>(m_arena->append(name.data(), name.size()));
+        entry.name_size = static_cast<std::uint32_t>(name.size());
+    } else {
+        entry.owned_name = name;
+    }
+}
+
 void write_string_list(MiniPackBuilder *builder,const std::string &entry_name,const std::vector<std::string> &str_list,std::string &err)
 {
     if (!builder) {
@@ -213,7 +535,7 @@ void write_string_list(MiniPackBuilder *builder,const std::string &entry_name,co
     }
 
     // Add as a single entry
-    if (!builder->add_entry_from_buffer(entry_name, buf, err)) {
+    if (!builder->add_entry_from_buffer(entry_name, std::move(buf), err)) {
         // err is already set by add_entry_from_buffer
         return;
     }
@@ -2,17 +2,32 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "pack_reader.h"
 
+class MiniPackStats;
+
 struct MiniPackBuildResult
 {
     std::size_t info_size=0;
     std::uint64_t total_data_size=0;
     std::size_t file_count=0;
+    std::uint32_t volume_count=0;   // multi-volume packs only
+};
+
+// One piece of a gathered write
+struct MiniPackIoSlice
+{
+    const std::uint8_t *data=nullptr;
+    std::size_t size=0;
 };
 
 // Abstract writer interface
@@ -22,12 +37,146 @@ public:
     virtual ~MiniPackWriter()=default;
     // Write 'size' bytes from data, return true on success, false and set err on failure
     virtual bool write(const std::uint8_t *data,std::size_t size,std::string &err)=0;
+    // Write several slices in order. The slices only need to stay valid for the call.
+    virtual bool write_gather(const MiniPackIoSlice *slices,std::size_t count,std::string &err)
+    {
+        for(std::size_t i=0;i<count;++i)
+            if(slices[i].size>0&&!write(slices[i].data,slices[i].size,err))return false;
+        return true;
+    }
+    // Called by build_pack before the first write with the exact number of bytes that will follow.
+    virtual bool reserve(std::uint64_t total_size,std::string &err){(void)total_size;(void)err;return true;}
+    // Called by build_pack after the last write; buffered writers push pending data here.
+    virtual bool flush(std::string &err){(void)err;return true;}
+
+    // Positional writes (optional): write at an absolute offset from the start of the output.
+    // Writers that support them allow concurrent calls for non-overlapping ranges; they are
+    // not mixed with write()/write_gather() without a flush in between.
+    virtual bool supports_write_at() const{return false;}
+    virtual bool write_at(std::uint64_t offset,const std::uint8_t *data,std::size_t size,std::string &err)
+    {
+        (void)offset;(void)data;(void)size;
+        err="Writer does not support positional writes";
+        return false;
+    }
+};
+
+// Optional counters filled in by writers that support them
+struct MiniPackWriterStats
+{
+    std::uint64_t bytes_written=0;
+    std::uint64_t write_calls=0;        // MiniPackWriter::write calls
+    std::uint64_t os_write_calls=0;     // writes issued to the OS
+    std::uint64_t preallocated_bytes=0;
+    double write_seconds=0.0;           // time spent inside OS writes
+
+    double bytes_per_second() const { return write_seconds>0.0?static_cast<double>(bytes_written)/write_seconds:0.0; }
+};
+
+// Diagnostic messages from writers; never invoked per write call
+using MiniPackLogCallback=std::function<void(const std::string &message)>;
+
+struct MiniPackFileWriterOptions
+{
+    std::size_t block_size=4*1024*1024;     // writes are gathered into blocks of this size (4 KiB aligned)
+    bool preallocate=true;                  // allocate the final size up front once reserve() reports it
+    MiniPackWriterStats *stats=nullptr;     // must outlive the writer
+    MiniPackLogCallback log;
 };
 
 // Factory functions to create default writers. Implementations hidden in cpp
 std::unique_ptr<MiniPackWriter> create_vector_writer(std::vector<std::uint8_t> &out);
 // Create a writer that writes directly to a file specified by path. Returns nullptr on failure to open file.
 std::unique_ptr<MiniPackWriter> create_file_writer(const std::string &path);
+std::unique_ptr<MiniPackWriter> create_file_writer(const std::string &path,const MiniPackFileWriterOptions &options);
+
+struct MiniPackAsyncWriterOptions
+{
+    std::size_t block_size=4*1024*1024;     // bytes per queued block
+    std::size_t block_count=2;              // blocks in flight (2 = double buffering); writes wait when all are queued
+};
+
+// Decorator that hands writes to a background thread: data is copied into one of a
+// fixed set of reusable blocks and written to 'inner' while the caller produces the
+// next. A failed inner write is reported by the next write/flush. reserve/flush wait
+// for the queue to drain. The decorator owns 'inner'.
+std::unique_ptr<MiniPackWriter> create_async_writer(std::unique_ptr<MiniPackWriter> inner);
+std::unique_ptr<MiniPackWriter> create_async_writer(std::unique_ptr<MiniPackWriter> inner,const MiniPackAsyncWriterOptions &options);
+
+// Append-only byte arena made of large fixed-size chunks. Returned pointers stay
+// valid until clear(); requests larger than a chunk get a dedicated chunk.
+class ChunkedByteArena
+{
+public:
+    explicit ChunkedByteArena(std::size_t chunk_size=16*1024*1024):m_chunk_size(chunk_size?chunk_size:1){}
+
+    std::uint8_t *allocate(std::size_t size)
+    {
+        if(size>m_chunk_size)
+        {
+            m_chunks.emplace_back(new std::uint8_t[size]);
+            m_bytes_used+=size;
+            return m_chunks.back().get();
+        }
+        if(size>m_remaining)
+        {
+            m_chunks.emplace_back(new std::uint8_t[m_chunk_size]);
+            m_cursor=m_chunks.back().get();
+            m_remaining=m_chunk_size;
+        }
+        std::uint8_t *p=m_cursor;
+        m_cursor+=size;
+        m_remaining-=size;
+        m_bytes_used+=size;
+        return p;
+    }
+
+    const std::uint8_t *append(const void *data,std::size_t size)
+    {
+        std::uint8_t *p=allocate(size);
+        if(size>0)std::memcpy(p,data,size);
+        return p;
+    }
+
+    void clear()
+    {
+        m_chunks.clear();
+        m_cursor=nullptr;
+        m_remaining=0;
+        m_bytes_used=0;
+    }
+
+    std::size_t bytes_used() const{return m_bytes_used;}
+    std::size_t chunk_count() const{return m_chunks.size();}
+
+private:
+    std::vector<std::unique_ptr<std::uint8_t[]>> m_chunks;
+    std::size_t m_chunk_size;
+    std::uint8_t *m_cursor=nullptr;
+    std::size_t m_remaining=0;
+    std::size_t m_bytes_used=0;
+};
+
+// Owned pack image built in memory with a single exact-size allocation.
+// The bytes are a complete pack and can be handed to load_minipack_index_from_memory.
+class MiniPackImage
+{
+public:
+    MiniPackImage()=default;
+
+    const std::uint8_t *data() const { return m_data.get(); }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size==0; }
+    std::span<const std::uint8_t> bytes() const { return {m_data.get(),m_size}; }
+
+    void clear() { m_data.reset(); m_size=0; }
+
+private:
+    friend class MiniPackBuilder;
+
+    std::unique_ptr<std::uint8_t[]> m_data;
+    std::size_t m_size=0;
+};
 
 class MiniPackBuilder
 {
@@ -38,35 +187,126 @@ public:
     bool empty() const;
     std::size_t file_count() const;
 
-    // Public API: add data buffers
+    // Arena mode: names and copied payloads are appended to large shared chunks
+    // instead of one heap allocation each. Must be enabled before the first add.
+    bool enable_arena(std::size_t chunk_size=16*1024*1024);
+    bool arena_enabled() const{return m_arena!=nullptr;}
+    // Arena mode only: storage owned by the builder for a payload the caller fills in
+    // place (e.g. reads a file into), then adds with add_entry_borrowed. nullptr otherwise.
+    std::uint8_t *allocate_entry_bytes(std::size_t size){return m_arena?m_arena->allocate(size):nullptr;}
+
+    // Reserve room for 'count' entries up front
+    void reserve(std::size_t count){m_entries.reserve(count);}
+
+    // Public API: add data buffers (copied)
     bool add_entry_from_buffer(const std::string &name,const std::vector<std::uint8_t> &data,std::string &err);
-    // Overload: add from raw pointer and size (uint32)
+    // Overload: take ownership of the buffer without copying
+    bool add_entry_from_buffer(const std::string &name,std::vector<std::uint8_t> &&data,std::string &err);
+    // Overload: add from raw pointer and size (uint32), copied once
     bool add_entry_from_buffer(const std::string &name,const void *data,std::uint32_t size,std::string &err);
 
+    // Borrow caller-owned bytes without copying or allocating for the payload.
+    // The bytes must stay valid and unchanged until the last build_pack/build_pack_image
+    // call that uses them, or until the builder is cleared or destroyed.
+    bool add_entry_borrowed(const std::string &name,std::span<const std::uint8_t> data,std::string &err);
+
+    // Deferred payload: 'source' fills exactly 'size' bytes when the pack is written, so
+    // the data never has to be held by the builder. build_pack_parallel and
+    // build_pack_volumes call sources from several threads at once.
+    using EntrySource=std::function<bool(std::uint8_t *dst,std::size_t size,std::string &err)>;
+    bool add_entry_from_source(const std::string &name,std::uint64_t size,EntrySource source,std::string &err);
+
     template<typename T>
     bool add_entry_from_array(const std::string &name,const std::vector<T> &data,std::string &err)
     {
         return add_entry_from_buffer(name, reinterpret_cast<const std::uint8_t*>(data.data()), data.size()*sizeof(T), err);
     }
 
+    // Store names front-coded (format v2): much smaller indexes for deep trees and no 255-byte name limit.
+    // Packs written this way need a reader that understands v2.
+    void set_front_coded_names(bool enable){m_front_coded_names=enable;}
+    bool front_coded_names() const{return m_front_coded_names;}
+
+    // Place every non-empty entry at a file offset that is a multiple of 'alignment'
+    // (a power of two up to 4096, default 1), so mapped packs can be viewed as typed
+    // arrays in place. Gaps are zero-filled. Returns false for an invalid alignment.
+    bool set_entry_alignment(std::uint32_t alignment)
+    {
+        if(alignment==0||alignment>4096||(alignment&(alignment-1))!=0)return false;
+        m_entry_alignment=alignment;
+        return true;
+    }
+    std::uint32_t entry_alignment() const{return m_entry_alignment;}
+
+    // Split the data area into volume files of at most 'bytes' each (0 = single file,
+    // below 4 GiB). The pack file then holds only the index, entries record
+    // (volume, offset) and the pack is written with build_pack_volumes. Format v2.
+    bool set_volume_size(std::uint64_t bytes)
+    {
+        if(bytes>std::numeric_limits<std::uint32_t>::max())return false;
+        m_volume_size=bytes;
+        return true;
+    }
+    std::uint64_t volume_size() const{return m_volume_size;}
+
+    using VolumeWriterFactory=std::function<std::unique_ptr<MiniPackWriter>(std::uint32_t volume,std::string &err)>;
+
     // Build the pack and write into provided writer pointer.
-    bool build_pack(MiniPackWriter *writer,bool index_only,MiniPackBuildResult &result,std::string &err) const;
+    // 'stats' (optional, see minipack_stats.h) records the build's size and latency.
+    bool build_pack(MiniPackWriter *writer,bool index_only,MiniPackBuildResult &result,std::string &err,MiniPackStats *stats=nullptr) const;
+
+    // Build the pack into an exactly sized memory image (one allocation, written in place).
+    bool build_pack_image(MiniPackImage &image,bool index_only,MiniPackBuildResult &result,std::string &err,MiniPackStats *stats=nullptr) const;
+
+    // Parallel build: once the index fixes every entry's offset, up to 'threads' workers
+    // (0 = hardware concurrency) produce runs of consecutive entries (copying or calling
+    // their sources) and write each run at its final offset with write_at. Writers
+    // without positional writes fall back to build_pack. Same output as build_pack.
+    bool build_pack_parallel(MiniPackWriter *writer,MiniPackBuildResult &result,std::string &err,unsigned threads=0,MiniPackStats *stats=nullptr) const;
+
+    // Multi-volume build (see set_volume_size): the index goes to 'index_writer' and the
+    // data of volume v (1-based) to the writer returned by open_volume(v). Volumes are
+    // written concurrently by up to 'threads' workers (0 = hardware concurrency), so
+    // open_volume must be safe to call from several threads.
+    bool build_pack_volumes(MiniPackWriter *index_writer,const VolumeWriterFactory &open_volume,MiniPackBuildResult &result,std::string &err,unsigned threads=0,MiniPackStats *stats=nullptr) const;
 
 protected:
     bool build_index(std::vector<std::uint8_t> &header,std::vector<std::uint32_t> &offsets,MiniPackBuildResult &result,std::string &err) const;
+    // Same, also returning each entry's volume (empty unless a volume size is set)
+    bool build_index(std::vector<std::uint8_t> &header,std::vector<std::uint32_t> &offsets,std::vector<std::uint32_t> &volumes,MiniPackBuildResult &result,std::string &err) const;
 
 private:
-    bool add_entry_internal(std::string name,std::vector<std::uint8_t> data,std::string &err);
-    // Overload: internal add using raw pointer and size (uint32)
-    bool add_entry_internal(std::string name,const void *data,std::uint32_t size,std::string &err);
-
     struct Entry
     {
-        std::string name;
-        std::vector<std::uint8_t> data;
+        std::string owned_name;                 // unused in arena mode
+        const char *arena_name=nullptr;
+        std::uint32_t name_size=0;
+        std::vector<std::uint8_t> owned;        // move-in entries
+        const std::uint8_t *borrowed=nullptr;   // caller-owned (add_entry_borrowed) or arena bytes
+        EntrySource source;                     // deferred entries (add_entry_from_source)
+        std::size_t size=0;
+
+        std::string_view name() const{return arena_name?std::string_view(arena_name,name_size):std::string_view(owned_name);}
+        const std::uint8_t *bytes() const{return borrowed?borrowed:owned.data();}
     };
 
+    bool write_pack(MiniPackWriter *writer,bool index_only,MiniPackBuildResult &result,std::uint64_t &total_size,std::string &err) const;
+    bool write_pack_image(MiniPackImage &image,bool index_only,MiniPackBuildResult &result,std::string &err) const;
+    bool write_pack_parallel(MiniPackWriter *writer,MiniPackBuildResult &result,std::uint64_t &total_size,std::string &err,unsigned threads) const;
+    // Copy or produce an entry's bytes into dst (entry.size bytes)
+    bool fill_entry(const Entry &entry,std::uint8_t *dst,std::string &err) const;
+    // Write the data of every entry placed in 'volume' (all entries when 'volumes' is empty)
+    bool write_entry_data(MiniPackWriter *writer,const std::vector<std::uint32_t> &offsets,const std::vector<std::uint32_t> &volumes,std::uint32_t volume,std::string &err) const;
+
+    bool add_entry_internal(const std::string &name,std::vector<std::uint8_t> &&data,std::string &err);
+    bool add_entry_copy(const std::string &name,const std::uint8_t *data,std::size_t size,std::string &err);
+    void set_entry_name(Entry &entry,const std::string &name);
+
     std::vector<Entry> m_entries;
+    std::unique_ptr<ChunkedByteArena> m_arena;
+    bool m_front_coded_names=false;
+    std::uint32_t m_entry_alignment=1;
+    std::uint64_t m_volume_size=0;
 };
 
 void write_string_list(MiniPackBuilder *builder,const std::string &entry_name,const std::vector<std::string> &list,std::string &err);
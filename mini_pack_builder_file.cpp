@@ -1,12 +1,19 @@
 ﻿#include "mini_pack_builder_file.h"
+#include "minipack_format.h"
+#include "minipack_trace.h"
 
+#include <deque>
+#include <filesystem>
 #include <fstream>
 #include <limits>
+#include <mutex>
 #include <vector>
 #include <cstdint>
+#include <utility>
 
 bool add_file_to_builder(MiniPackBuilder &builder, const std::string &file_path, const std::string &stored_name, std::string &err)
 {
+    MiniPackTraceScope trace("add_file_to_builder", "input", stored_name.empty() ? file_path : stored_name);
     // Open file and read whole contents into memory
     std::ifstream in(file_path, std::ios::binary | std::ios::ate);
     if (!in) {
@@ -26,12 +33,20 @@ bool add_file_to_builder(MiniPackBuilder &builder, const std::string &file_path,
         return false;
     }
 
+    const std::size_t size = static_cast<std::size_t>(file_size);
+    std::string effective_name = stored_name.empty() ? file_path : stored_name;
+
+    // In arena mode the file is read straight into builder-owned arena storage
     std::vector<std::uint8_t> buffer;
-    buffer.resize(static_cast<std::size_t>(file_size));
+    std::uint8_t *dst = size > 0 ? builder.allocate_entry_bytes(size) : nullptr;
+    if (!dst) {
+        buffer.resize(size);
+        dst = buffer.data();
+    }
 
     in.seekg(0, std::ios::beg);
     if (file_size > 0) {
-        in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        in.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(size));
         if (!in) {
             err = "Failed to read input file: " + file_path;
             return false;
@@ -39,11 +54,84 @@ bool add_file_to_builder(MiniPackBuilder &builder, const std::string &file_path,
     }
     in.close();
 
-    std::string effective_name = stored_name.empty() ? file_path : stored_name;
-    return builder.add_entry_from_buffer(effective_name, buffer, err);
+    if (buffer.empty() && size > 0) return builder.add_entry_borrowed(effective_name, std::span<const std::uint8_t>(dst, size), err);
+    return builder.add_entry_from_buffer(effective_name, std::move(buffer), err);
 }
 
 bool add_file_to_builder(MiniPackBuilder &builder, const std::string &file_path, std::string &err)
 {
     return add_file_to_builder(builder, file_path, file_path, err);
 }
+
+bool add_file_to_builder_deferred(MiniPackBuilder &builder, const std::string &file_path, const std::string &stored_name, std::string &err)
+{
+    std::error_code ec;
+    const std::uint64_t file_size = std::filesystem::file_size(file_path, ec);
+    if (ec) {
+        err = "Failed to determine size for file: " + file_path;
+        return false;
+    }
+    return add_file_to_builder_deferred(builder, file_path, stored_name, file_size, err);
+}
+
+bool add_file_to_builder_deferred(MiniPackBuilder &builder, const std::string &file_path, const std::string &stored_name, std::uint64_t file_size, std::string &err)
+{
+    if (file_size > std::numeric_limits<std::uint32_t>::max()) {
+        err = "File too large (must fit in 32-bit size): " + file_path;
+        return false;
+    }
+
+    auto source = [file_path](std::uint8_t *dst, std::size_t size, std::string &source_err) {
+        MiniPackTraceScope trace("read_input", "input", file_path);
+        std::ifstream in(file_path, std::ios::binary);
+        if (!in) { source_err = "Failed to open input file: " + file_path; return false; }
+        in.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(size));
+        if (!in || in.peek() != std::ifstream::traits_type::eof()) {
+            source_err = "Input file changed size since it was added: " + file_path;
+            return false;
+        }
+        return true;
+    };
+    return builder.add_entry_from_source(stored_name.empty() ? file_path : stored_name, file_size, source, err);
+}
+
+bool build_pack_volume_files(const MiniPackBuilder &builder, const std::string &pack_path, const MiniPackFileWriterOptions &options, MiniPackBuildResult &result, std::string &err, unsigned threads)
+{
+    auto index_writer = create_file_writer(pack_path, options);
+    if (!index_writer) { err = "Failed to open output file: " + pack_path; return false; }
+
+    // Writer stats are not thread-safe, so each volume counts into its own slot
+    std::mutex stats_mutex;
+    std::deque<MiniPackWriterStats> volume_stats;
+    auto open_volume = [&](std::uint32_t volume, std::string &volume_err) -> std::unique_ptr<MiniPackWriter> {
+        MiniPackFileWriterOptions volume_options = options;
+        if (options.stats) {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            volume_options.stats = &volume_stats.emplace_back();
+        }
+        const std::string path = minipack_format::volume_path(pack_path, volume);
+        auto writer = create_file_writer(path, volume_options);
+        if (!writer) volume_err = "Failed to open output file: " + path;
+        return writer;
+    };
+
+    const bool ok = builder.build_pack_volumes(index_writer.get(), open_volume, result, err, threads);
+    index_writer.reset();
+    if (options.stats) {
+        for (const MiniPackWriterStats &s : volume_stats) {
+            options.stats->bytes_written += s.bytes_written;
+            options.stats->write_calls += s.write_calls;
+            options.stats->os_write_calls += s.os_write_calls;
+            options.stats->preallocated_bytes += s.preallocated_bytes;
+            options.stats->write_seconds += s.write_seconds;
+        }
+    }
+    if (!ok) return false;
+
+    std::error_code ec;
+    for (std::uint32_t v = result.volume_count + 1;; ++v) {
+        const std::string stale = minipack_format::volume_path(pack_path, v);
+        if (!std::filesystem::remove(stale, ec)) break;
+    }
+    return true;
+}
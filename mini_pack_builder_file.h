@@ -14,3 +14,18 @@ bool add_file_to_builder(MiniPackBuilder &builder, const std::string &file_path,
 
 // Convenience overload: store under the same name as on disk.
 bool add_file_to_builder(MiniPackBuilder &builder, const std::string &file_path, std::string &err);
+
+// Deferred variant: only the file size is taken now; the file is read when the pack
+// is written (MiniPackBuilder::add_entry_from_source), so nothing is held in memory
+// and build_pack_parallel reads inputs on its worker threads. The file must keep its size.
+bool add_file_to_builder_deferred(MiniPackBuilder &builder, const std::string &file_path, const std::string &stored_name, std::string &err);
+
+// Same, with the size already known (e.g. ScannedFile::size from scan_directory), so the
+// file is not stat'ed again.
+bool add_file_to_builder_deferred(MiniPackBuilder &builder, const std::string &file_path, const std::string &stored_name, std::uint64_t file_size, std::string &err);
+
+// Write a multi-volume pack (MiniPackBuilder::set_volume_size): the index goes to
+// 'pack_path' and volume v to "<pack_path>.NNN", written concurrently by up to
+// 'threads' workers. Volume files left over from an earlier, larger build are removed.
+// options.stats, if set, receives the totals over all files.
+bool build_pack_volume_files(const MiniPackBuilder &builder, const std::string &pack_path, const MiniPackFileWriterOptions &options, MiniPackBuildResult &result, std::string &err, unsigned threads = 0);
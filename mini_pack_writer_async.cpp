@@ -0,0 +1,173 @@
+﻿#include "mini_pack_builder.h"
+#include "minipack_trace.h"
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class AsyncWriterImpl final : public MiniPackWriter {
+public:
+    AsyncWriterImpl(std::unique_ptr<MiniPackWriter> inner, const MiniPackAsyncWriterOptions &options)
+        : m_inner(std::move(inner))
+        , m_block_size(options.block_size > 0 ? options.block_size : 1)
+    {
+        const std::size_t count = options.block_count > 0 ? options.block_count : 1;
+        m_blocks.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            m_blocks[i].data.reset(new std::uint8_t[m_block_size]);
+            m_free.push_back(i);
+        }
+        m_thread = std::thread([this] { run(); });
+    }
+
+    ~AsyncWriterImpl() override {
+        std::string err;
+        submit_current(err);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_work_ready.notify_one();
+        m_thread.join();
+    }
+
+    bool reserve(std::uint64_t total_size, std::string &err) override {
+        // The inner writer is only used by one thread at a time: wait until it is idle
+        return submit_current(err) && drain(err) && m_inner->reserve(total_size, err);
+    }
+
+    bool write(const std::uint8_t *data, std::size_t size, std::string &err) override {
+        while (size > 0) {
+            if (m_current == kNoBlock && !acquire(err)) return false;
+            Block &block = m_blocks[m_current];
+            const std::size_t n = size < m_block_size - block.used ? size : m_block_size - block.used;
+            std::memcpy(block.data.get() + block.used, data, n);
+            block.used += n;
+            data += n;
+            size -= n;
+            if (block.used == m_block_size && !submit_current(err)) return false;
+        }
+        return true;
+    }
+
+    bool flush(std::string &err) override {
+        return submit_current(err) && drain(err) && m_inner->flush(err);
+    }
+
+private:
+    static constexpr std::size_t kNoBlock = static_cast<std::size_t>(-1);
+
+    struct Block
+    {
+        std::unique_ptr<std::uint8_t[]> data;
+        std::size_t used = 0;
+    };
+
+    // Take a free block for the caller, waiting while all blocks are queued (backpressure)
+    bool acquire(std::string &err) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_free.empty()) {
+            MiniPackTraceScope trace("async_writer_wait", "write");
+            m_block_free.wait(lock, [this] { return !m_free.empty() || m_failed; });
+        }
+        if (m_failed) { err = m_error; return false; }
+        m_current = m_free.front();
+        m_free.pop_front();
+        return true;
+    }
+
+    // Queue the caller's partly or fully filled block for the background thread
+    bool submit_current(std::string &err) {
+        if (m_current == kNoBlock) return check(err);
+        const std::size_t index = m_current;
+        m_current = kNoBlock;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_blocks[index].used == 0 || m_failed) {
+                m_blocks[index].used = 0;
+                m_free.push_back(index);
+            } else {
+                m_queued.push_back(index);
+            }
+        }
+        m_work_ready.notify_one();
+        return check(err);
+    }
+
+    // Wait until every queued block has been written
+    bool drain(std::string &err) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_block_free.wait(lock, [this] { return (m_queued.empty() && !m_busy) || m_failed; });
+        if (m_failed) { err = m_error; return false; }
+        return true;
+    }
+
+    bool check(std::string &err) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_failed) { err = m_error; return false; }
+        return true;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_work_ready.wait(lock, [this] { return !m_queued.empty() || m_stop; });
+            if (m_queued.empty()) return;
+            const std::size_t index = m_queued.front();
+            m_queued.pop_front();
+            Block &block = m_blocks[index];
+            bool ok = true;
+            std::string err;
+            if (!m_failed) {
+                // Write without holding the lock so the caller can fill the other blocks
+                m_busy = true;
+                lock.unlock();
+                {
+                    MiniPackTraceScope trace("async_writer_write", "write");
+                    ok = m_inner->write(block.data.get(), block.used, err);
+                }
+                lock.lock();
+                m_busy = false;
+            }
+            if (!ok && !m_failed) {
+                m_failed = true;
+                m_error = err;
+            }
+            block.used = 0;
+            m_free.push_back(index);
+            m_block_free.notify_all();
+        }
+    }
+
+    std::unique_ptr<MiniPackWriter> m_inner;
+    std::size_t m_block_size;
+    std::vector<Block> m_blocks;
+    std::size_t m_current = kNoBlock;   // block being filled by the caller
+
+    std::mutex m_mutex;
+    std::condition_variable m_work_ready;
+    std::condition_variable m_block_free;
+    std::deque<std::size_t> m_free;
+    std::deque<std::size_t> m_queued;
+    bool m_busy = false;
+    bool m_failed = false;
+    bool m_stop = false;
+    std::string m_error;
+    std::thread m_thread;
+};
+
+} // namespace
+
+std::unique_ptr<MiniPackWriter> create_async_writer(std::unique_ptr<MiniPackWriter> inner, const MiniPackAsyncWriterOptions &options) {
+    if (!inner) return nullptr;
+    return std::make_unique<AsyncWriterImpl>(std::move(inner), options);
+}
+
+std::unique_ptr<MiniPackWriter> create_async_writer(std::unique_ptr<MiniPackWriter> inner) {
+    return create_async_writer(std::move(inner), MiniPackAsyncWriterOptions{});
+}
@@ -1,64 +1,305 @@
 ﻿#include "mini_pack_builder.h"
-#include <fstream>
+#include "minipack_trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
 #include <memory>
-#include <iostream>
+#include <mutex>
+#include <new>
 #include <string>
+#include <vector>
 
-class FileWriterImpl : public MiniPackWriter {
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::size_t kBlockAlign = 4096;
+
+struct AlignedDelete {
+    void operator()(std::uint8_t *p) const { ::operator delete[](p, std::align_val_t(kBlockAlign)); }
+};
+using AlignedBlock = std::unique_ptr<std::uint8_t[], AlignedDelete>;
+
+// Thin platform layer over a raw file descriptor
+#ifdef _WIN32
+int os_open(const std::string &path) { return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE); }
+long long os_write(int fd, const std::uint8_t *data, std::size_t size) { return _write(fd, data, static_cast<unsigned int>(size > 0x40000000 ? 0x40000000 : size)); }
+bool os_preallocate(int, std::uint64_t) { return false; }
+bool os_truncate(int fd, std::uint64_t size) { return _chsize_s(fd, static_cast<long long>(size)) == 0; }
+long long os_write_at(int fd, std::uint64_t offset, const std::uint8_t *data, std::size_t size)
+{
+    OVERLAPPED ov{};
+    ov.Offset = static_cast<DWORD>(offset);
+    ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD done = 0;
+    const DWORD n = static_cast<DWORD>(size > 0x40000000 ? 0x40000000 : size);
+    if (!WriteFile(reinterpret_cast<HANDLE>(_get_osfhandle(fd)), data, n, &done, &ov)) { errno = EIO; return -1; }
+    return static_cast<long long>(done);
+}
+int os_close(int fd) { return _close(fd); }
+#else
+int os_open(const std::string &path) { return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); }
+long long os_write(int fd, const std::uint8_t *data, std::size_t size) { return ::write(fd, data, size); }
+bool os_preallocate(int fd, std::uint64_t size)
+{
+#if defined(__linux__)
+    return ::posix_fallocate(fd, 0, static_cast<off_t>(size)) == 0;
+#else
+    (void)fd; (void)size;
+    return false;
+#endif
+}
+bool os_truncate(int fd, std::uint64_t size) { return ::ftruncate(fd, static_cast<off_t>(size)) == 0; }
+long long os_write_at(int fd, std::uint64_t offset, const std::uint8_t *data, std::size_t size) { return ::pwrite(fd, data, size, static_cast<off_t>(offset)); }
+int os_close(int fd) { return ::close(fd); }
+#endif
+
+class FileWriterImpl final : public MiniPackWriter {
 public:
-    explicit FileWriterImpl(const std::string &path)
-        : m_out(path, std::ios::binary | std::ios::out | std::ios::trunc), m_path(path)
+    FileWriterImpl(const std::string &path, const MiniPackFileWriterOptions &options)
+        : m_path(path), m_options(options)
     {
-        if (m_out.is_open() && static_cast<bool>(m_out)) {
-            std::cout << "[MiniPack][FileWriter] " << m_path << " - Opened output file" << "\n";
-        } else {
-            std::cerr << "[MiniPack][FileWriter] " << m_path << " - Failed to open output file" << "\n";
+        if (m_options.block_size < kBlockAlign) m_options.block_size = kBlockAlign;
+        m_options.block_size = (m_options.block_size + kBlockAlign - 1) / kBlockAlign * kBlockAlign;
+
+        m_fd = os_open(path);
+        if (m_fd < 0) {
+            log(std::string("Failed to open output file: ") + std::strerror(errno));
+            return;
         }
+        m_block.reset(static_cast<std::uint8_t*>(::operator new[](m_options.block_size, std::align_val_t(kBlockAlign))));
+        log("Opened output file");
     }
 
     ~FileWriterImpl() override {
-        if (m_out.is_open()) {
-            m_out.flush();
-            if (!m_out) {
-                std::cerr << "[MiniPack][FileWriter] " << m_path << " - Flush failed" << "\n";
-            } else {
-                std::cout << "[MiniPack][FileWriter] " << m_path << " - Flushed file successfully" << "\n";
-            }
-            m_out.close();
-            std::cout << "[MiniPack][FileWriter] " << m_path << " - Closed output file" << "\n";
-        }
+        if (m_fd < 0) return;
+        std::string err;
+        if (!flush(err)) log("Flush failed: " + err);
+        // Drop any preallocated tail that was never written (e.g. a failed build)
+        const std::uint64_t end = std::max(m_offset, m_positional_end.load());
+        if (m_preallocated > end && !os_truncate(m_fd, end)) log("Failed to trim preallocated space");
+        if (os_close(m_fd) != 0) log("Close failed");
+        else log("Closed output file (" + std::to_string(end) + " bytes)");
     }
 
-    bool ok() const { return m_out.is_open() && static_cast<bool>(m_out); }
+    bool ok() const { return m_fd >= 0; }
+
+    bool reserve(std::uint64_t total_size, std::string &err) override {
+        (void)err;
+        if (!m_options.preallocate || total_size <= m_offset + m_used) return true;
+        if (os_preallocate(m_fd, total_size)) {
+            m_preallocated = total_size;
+            if (m_options.stats) m_options.stats->preallocated_bytes = total_size;
+            log("Preallocated " + std::to_string(total_size) + " bytes");
+        }
+        // Preallocation is an optimization; failure is not an error
+        return true;
+    }
 
     bool write(const std::uint8_t *data, std::size_t size, std::string &err) override {
-        if (size == 0) {
-            std::cout << "[MiniPack][FileWriter] " << m_path << " - Skipping zero-size write" << "\n";
+        if (m_options.stats) ++m_options.stats->write_calls;
+        const std::size_t block = m_options.block_size;
+        while (size > 0) {
+            // Large writes with an empty buffer bypass the copy
+            if (m_used == 0 && size >= block) {
+                const std::size_t direct = size - size % block;
+                if (!write_all(data, direct, err)) return false;
+                data += direct;
+                size -= direct;
+                continue;
+            }
+            const std::size_t n = size < block - m_used ? size : block - m_used;
+            std::memcpy(m_block.get() + m_used, data, n);
+            m_used += n;
+            data += n;
+            size -= n;
+            if (m_used == block && !flush(err)) return false;
+        }
+        return true;
+    }
+
+#ifndef _WIN32
+    // Small slices are packed into the block buffer and large ones referenced in
+    // place; both go out together through writev.
+    bool write_gather(const MiniPackIoSlice *slices, std::size_t count, std::string &err) override {
+        if (m_options.stats) ++m_options.stats->write_calls;
+        const std::size_t block = m_options.block_size;
+        const std::size_t direct_threshold = block / 8;
+        m_iov.clear();
+        bool last_is_block = false;
+        if (m_used > 0) {
+            m_iov.push_back(iovec{m_block.get(), m_used});
+            last_is_block = true;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::uint8_t *data = slices[i].data;
+            const std::size_t size = slices[i].size;
+            if (size == 0) continue;
+            if (m_iov.size() >= kMaxIov) {
+                if (!writev_pending(err)) return false;
+                last_is_block = false;
+            }
+            if (size >= direct_threshold) {
+                m_iov.push_back(iovec{const_cast<std::uint8_t*>(data), size});
+                last_is_block = false;
+                continue;
+            }
+            if (size > block - m_used) {
+                if (!writev_pending(err)) return false;
+                last_is_block = false;
+            }
+            std::memcpy(m_block.get() + m_used, data, size);
+            if (last_is_block) m_iov.back().iov_len += size;
+            else m_iov.push_back(iovec{m_block.get() + m_used, size});
+            m_used += size;
+            last_is_block = true;
+        }
+        // A lone buffered segment at the start of the block can stay buffered
+        if (m_iov.size() == 1 && last_is_block && m_iov[0].iov_base == m_block.get()) {
+            m_iov.clear();
             return true;
         }
-        std::cout << "[MiniPack][FileWriter] " << m_path << " - Writing " << size << " bytes" << "\n";
-        m_out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
-        if (!m_out) {
-            err = "Failed to write to file";
-            std::cerr << "[MiniPack][FileWriter] " << m_path << " - Write failed (" << size << " bytes)" << "\n";
-            return false;
+        return writev_pending(err);
+    }
+#endif
+
+    bool supports_write_at() const override { return true; }
+
+    // Unbuffered positional write; safe to call from several threads for disjoint ranges
+    bool write_at(std::uint64_t offset, const std::uint8_t *data, std::size_t size, std::string &err) override {
+        MiniPackTraceScope trace("writer_write_at", "write");
+        const auto start = std::chrono::steady_clock::now();
+        std::uint64_t calls = 0;
+        const std::size_t total = size;
+        const std::uint64_t end = offset + size;
+        while (size > 0) {
+            const long long n = os_write_at(m_fd, offset, data, size);
+            ++calls;
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                err = "Failed to write to file: " + m_path + " (" + std::strerror(errno) + ")";
+                log(err);
+                return false;
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+            offset += static_cast<std::uint64_t>(n);
+        }
+        std::uint64_t prev = m_positional_end.load();
+        while (prev < end && !m_positional_end.compare_exchange_weak(prev, end)) {}
+        if (m_options.stats) {
+            std::lock_guard<std::mutex> lock(m_stats_mutex);
+            ++m_options.stats->write_calls;
+            m_options.stats->os_write_calls += calls;
+            m_options.stats->bytes_written += total;
+            m_options.stats->write_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
         }
-        std::cout << "[MiniPack][FileWriter] " << m_path << " - Wrote " << size << " bytes" << "\n";
         return true;
     }
 
+    bool flush(std::string &err) override {
+        if (m_used == 0) return true;
+        MiniPackTraceScope trace("writer_flush", "write");
+        const std::size_t n = m_used;
+        m_used = 0;
+        return write_all(m_block.get(), n, err);
+    }
+
 private:
-    std::ofstream m_out;
+    bool write_all(const std::uint8_t *data, std::size_t size, std::string &err) {
+        MiniPackTraceScope trace("writer_write", "write");
+        const auto start = std::chrono::steady_clock::now();
+        while (size > 0) {
+            const long long n = os_write(m_fd, data, size);
+            if (m_options.stats) ++m_options.stats->os_write_calls;
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                err = "Failed to write to file: " + m_path + " (" + std::strerror(errno) + ")";
+                log(err);
+                return false;
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+            m_offset += static_cast<std::uint64_t>(n);
+            if (m_options.stats) m_options.stats->bytes_written += static_cast<std::uint64_t>(n);
+        }
+        if (m_options.stats) m_options.stats->write_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+#ifndef _WIN32
+    // Write every pending iovec (block segments and referenced slices), then reset the block
+    bool writev_pending(std::string &err) {
+        MiniPackTraceScope trace("writer_writev", "write");
+        const auto start = std::chrono::steady_clock::now();
+        std::size_t idx = 0;
+        while (idx < m_iov.size()) {
+            const int cnt = static_cast<int>(std::min<std::size_t>(m_iov.size() - idx, kMaxIov));
+            const ssize_t n = ::writev(m_fd, &m_iov[idx], cnt);
+            if (m_options.stats) ++m_options.stats->os_write_calls;
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                err = "Failed to write to file: " + m_path + " (" + std::strerror(errno) + ")";
+                log(err);
+                return false;
+            }
+            m_offset += static_cast<std::uint64_t>(n);
+            if (m_options.stats) m_options.stats->bytes_written += static_cast<std::uint64_t>(n);
+            // Advance past what was written; a partial write resumes mid-iovec
+            std::size_t left = static_cast<std::size_t>(n);
+            while (idx < m_iov.size() && left >= m_iov[idx].iov_len) left -= m_iov[idx++].iov_len;
+            if (left > 0) {
+                m_iov[idx].iov_base = static_cast<std::uint8_t*>(m_iov[idx].iov_base) + left;
+                m_iov[idx].iov_len -= left;
+            }
+        }
+        m_iov.clear();
+        m_used = 0;
+        if (m_options.stats) m_options.stats->write_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    static constexpr std::size_t kMaxIov = 1024;
+    std::vector<iovec> m_iov;
+#endif
+
+    void log(const std::string &message) const {
+        if (m_options.log) m_options.log("[MiniPack][FileWriter] " + m_path + " - " + message);
+    }
+
     std::string m_path;
+    MiniPackFileWriterOptions m_options;
+    int m_fd = -1;
+    AlignedBlock m_block;
+    std::size_t m_used = 0;
+    std::uint64_t m_offset = 0;
+    std::uint64_t m_preallocated = 0;
+    std::atomic<std::uint64_t> m_positional_end{0};   // end of the furthest write_at
+    std::mutex m_stats_mutex;                         // write_at runs on several threads
 };
 
-std::unique_ptr<MiniPackWriter> create_file_writer(const std::string &path) {
-    std::cout << "[MiniPack][FileWriter] " << path << " - Creating file writer" << "\n";
-    auto fw = std::make_unique<FileWriterImpl>(path);
-    if (!fw->ok()) {
-        std::cerr << "[MiniPack][FileWriter] " << path << " - File writer creation failed" << "\n";
-        return nullptr;
-    }
-    std::cout << "[MiniPack][FileWriter] " << path << " - File writer created" << "\n";
+} // namespace
+
+std::unique_ptr<MiniPackWriter> create_file_writer(const std::string &path, const MiniPackFileWriterOptions &options) {
+    auto fw = std::make_unique<FileWriterImpl>(path, options);
+    if (!fw->ok()) return nullptr;
     return fw;
 }
+
+std::unique_ptr<MiniPackWriter> create_file_writer(const std::string &path) {
+    return create_file_writer(path, MiniPackFileWriterOptions{});
+}
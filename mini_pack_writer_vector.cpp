@@ -5,6 +5,16 @@
 class VectorWriterImpl : public MiniPackWriter {
 public:
     explicit VectorWriterImpl(std::vector<std::uint8_t> &out) : m_out(out) {}
+    bool reserve(std::uint64_t total_size, std::string &err) override {
+        // build_pack reports the exact size, so the vector grows only once
+        try {
+            m_out.reserve(m_out.size() + static_cast<std::size_t>(total_size));
+        } catch (const std::exception &e) {
+            err = e.what();
+            return false;
+        }
+        return true;
+    }
     bool write(const std::uint8_t *data, std::size_t size, std::string &err) override {
         if (size == 0) return true;
         try {
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+// Strict parsing of numeric command-line values: the whole argument must be a
+// decimal number that fits, otherwise the caller prints a usage error.
+
+namespace minipack_args {
+
+inline bool parse_u64(std::string_view s, std::uint64_t &out)
+{
+    const char *end = s.data() + s.size();
+    std::uint64_t v = 0;
+    const auto [ptr, ec] = std::from_chars(s.data(), end, v);
+    if (s.empty() || ec != std::errc() || ptr != end) return false;
+    out = v;
+    return true;
+}
+
+// Byte count with an optional K, M or G suffix (binary multiples)
+inline bool parse_size(std::string_view s, std::uint64_t &out)
+{
+    std::uint64_t scale = 1;
+    if (!s.empty()) {
+        switch (s.back()) {
+        case 'K': case 'k': scale = 1024ull; break;
+        case 'M': case 'm': scale = 1024ull * 1024; break;
+        case 'G': case 'g': scale = 1024ull * 1024 * 1024; break;
+        default: break;
+        }
+        if (scale != 1) s.remove_suffix(1);
+    }
+    std::uint64_t v = 0;
+    if (!parse_u64(s, v) || v > std::numeric_limits<std::uint64_t>::max() / scale) return false;
+    out = v * scale;
+    return true;
+}
+
+}
@@ -0,0 +1,488 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "minipack_args.h"
+#include "minipack_bench.h"
+#include "mini_pack_builder.h"
+#include "pack_reader_io.h"
+#include "pack_reader_memory.h"
+
+// Dependency-free timing harness for the reader and builder hot paths.
+// Generates a synthetic pack in a temporary directory, then reports index load
+// time, lookup latency percentiles, read throughput and build throughput either
+// as a human-readable table or as JSON (--json).
+
+namespace {
+
+using Clock = BenchClock;
+
+struct BenchConfig
+{
+    std::uint32_t entries = 10000;
+    std::uint32_t min_size = 256;
+    std::uint32_t max_size = 64 * 1024;
+    std::string distribution = "uniform"; // uniform | log | fixed
+    std::uint32_t lookups = 1000;
+    std::uint32_t random_reads = 2000;
+    std::uint32_t iterations = 5;
+    std::uint64_t seed = 12345;
+    std::string work_dir;
+    std::uint32_t utf_mb = 8;
+    std::uint32_t text_mb = 32;
+    std::uint32_t list_lines = 500000;
+    bool keep = false;
+    bool json = false;
+    bool verify_utf = false;
+};
+
+void print_json(std::ostream &os, const BenchReport &report, const BenchConfig &cfg)
+{
+    const auto &metrics = report.metrics();
+    os << "{\n";
+    os << "  \"config\": {\"entries\": " << cfg.entries << ", \"min_size\": " << cfg.min_size << ", \"max_size\": " << cfg.max_size
+       << ", \"distribution\": \"" << cfg.distribution << "\", \"lookups\": " << cfg.lookups << ", \"random_reads\": " << cfg.random_reads
+       << ", \"iterations\": " << cfg.iterations << ", \"seed\": " << cfg.seed << ", \"utf_mb\": " << cfg.utf_mb << ", \"text_mb\": " << cfg.text_mb << ", \"list_lines\": " << cfg.list_lines << "},\n";
+    os << "  \"metrics\": {\n";
+    for (std::size_t i = 0; i < metrics.size(); ++i) {
+        const auto &m = metrics[i];
+        os << "    \"" << m.name << "\": {\"value\": " << std::setprecision(6) << std::fixed << m.value << ", \"unit\": \"" << m.unit << "\"}";
+        os << (i + 1 < metrics.size() ? ",\n" : "\n");
+    }
+    os << "  }\n}\n";
+}
+
+// Silence std::cout while the builder runs; its add path logs every entry.
+double percentile(std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    std::size_t idx = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+std::vector<std::uint32_t> generate_sizes(const BenchConfig &cfg, std::mt19937_64 &rng)
+{
+    std::vector<std::uint32_t> sizes(cfg.entries);
+    if (cfg.distribution == "fixed") {
+        std::fill(sizes.begin(), sizes.end(), cfg.max_size);
+    } else if (cfg.distribution == "log") {
+        // Log-uniform: many small entries, a long tail of large ones
+        std::uniform_real_distribution<double> d(std::log(static_cast<double>(std::max<std::uint32_t>(cfg.min_size, 1))),
+                                                 std::log(static_cast<double>(std::max<std::uint32_t>(cfg.max_size, 1))));
+        for (auto &s : sizes) s = static_cast<std::uint32_t>(std::exp(d(rng)));
+    } else {
+        std::uniform_int_distribution<std::uint32_t> d(cfg.min_size, cfg.max_size);
+        for (auto &s : sizes) s = d(rng);
+    }
+    return sizes;
+}
+
+std::string synthetic_name(std::uint32_t i)
+{
+    // Spread entries over a shallow directory tree, as asset packs tend to be
+    std::ostringstream oss;
+    oss << "dir" << (i % 64) << "/sub" << ((i / 64) % 16) << "/file_" << i << ".bin";
+    return oss.str();
+}
+
+bool populate_builder(MiniPackBuilder &builder, const std::vector<std::string> &names, const std::vector<std::uint32_t> &sizes,
+                      const std::vector<std::uint8_t> &payload, std::string &err)
+{
+    builder.reserve(names.size());
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        if (!builder.add_entry_from_buffer(names[i], payload.data(), sizes[i], err)) return false;
+    }
+    return true;
+}
+
+bool parse_u32(const char *s, std::uint32_t &out)
+{
+    std::uint64_t v = 0;
+    if (!minipack_args::parse_u64(s, v) || v > 0xFFFFFFFFull) return false;
+    out = static_cast<std::uint32_t>(v);
+    return true;
+}
+
+void print_usage(const char *argv0)
+{
+    std::cout << "Usage: " << argv0 << " [options]\n"
+              << "  --entries N        number of synthetic entries (default 10000)\n"
+              << "  --min-size N       minimum entry size in bytes (default 256)\n"
+              << "  --max-size N       maximum entry size in bytes (default 65536)\n"
+              << "  --dist NAME        size distribution: uniform | log | fixed (default uniform)\n"
+              << "  --lookups N        number of timed name lookups (default 1000)\n"
+              << "  --random-reads N   number of random entry reads (default 2000)\n"
+              << "  --iterations N     repetitions for index load / build timing (default 5)\n"
+              << "  --seed N           RNG seed (default 12345)\n"
+              << "  --dir PATH         work directory (default: system temp)\n"
+              << "  --utf-mb N         size of the UTF converter benchmark text in MiB, 0 to skip (default 8)\n"
+              << "  --text-mb N        size of the text-file decoding benchmark in MiB, 0 to skip (default 32)\n"
+              << "  --list-lines N     lines in the file list parsing benchmark, 0 to skip (default 500000)\n"
+              << "  --keep             keep generated files\n"
+              << "  --json             print results as JSON\n"
+              << "  --verify-utf       check UTF fast paths against the scalar converters and exit\n";
+}
+
+bool parse_args(int argc, char **argv, BenchConfig &cfg)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto need = [&](std::uint32_t &dst) -> bool {
+            if (i + 1 >= argc) return false;
+            return parse_u32(argv[++i], dst);
+        };
+        if (a == "--entries") { if (!need(cfg.entries)) return false; }
+        else if (a == "--min-size") { if (!need(cfg.min_size)) return false; }
+        else if (a == "--max-size") { if (!need(cfg.max_size)) return false; }
+        else if (a == "--lookups") { if (!need(cfg.lookups)) return false; }
+        else if (a == "--random-reads") { if (!need(cfg.random_reads)) return false; }
+        else if (a == "--iterations") { if (!need(cfg.iterations)) return false; }
+        else if (a == "--utf-mb") { if (!need(cfg.utf_mb)) return false; }
+        else if (a == "--text-mb") { if (!need(cfg.text_mb)) return false; }
+        else if (a == "--list-lines") { if (!need(cfg.list_lines)) return false; }
+        else if (a == "--seed") {
+            if (i + 1 >= argc || !minipack_args::parse_u64(argv[++i], cfg.seed)) return false;
+        }
+        else if (a == "--dist") {
+            if (i + 1 >= argc) return false;
+            cfg.distribution = argv[++i];
+            if (cfg.distribution != "uniform" && cfg.distribution != "log" && cfg.distribution != "fixed") return false;
+        }
+        else if (a == "--dir") {
+            if (i + 1 >= argc) return false;
+            cfg.work_dir = argv[++i];
+        }
+        else if (a == "--keep") cfg.keep = true;
+        else if (a == "--json") cfg.json = true;
+        else if (a == "--verify-utf") cfg.verify_utf = true;
+        else return false;
+    }
+    if (cfg.entries == 0 || cfg.min_size > cfg.max_size || cfg.iterations == 0) return false;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    BenchConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (cfg.verify_utf) return verify_utf_equivalence(std::cout) ? 0 : 1;
+
+    std::error_code ec;
+    std::filesystem::path dir = cfg.work_dir.empty()
+        ? std::filesystem::temp_directory_path(ec) / ("minipack_bench_" + std::to_string(cfg.seed) + "_" + std::to_string(Clock::now().time_since_epoch().count()))
+        : std::filesystem::path(cfg.work_dir);
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        std::cerr << "Failed to create work directory: " << dir.string() << "\n";
+        return 1;
+    }
+    const std::string pack_path = (dir / "bench.pack").string();
+
+    std::mt19937_64 rng(cfg.seed);
+    const std::vector<std::uint32_t> sizes = generate_sizes(cfg, rng);
+    std::vector<std::string> names;
+    names.reserve(cfg.entries);
+    for (std::uint32_t i = 0; i < cfg.entries; ++i) names.push_back(synthetic_name(i));
+
+    std::uint64_t total_bytes = 0;
+    for (auto s : sizes) total_bytes += s;
+
+    std::vector<std::uint8_t> payload(cfg.max_size);
+    for (auto &b : payload) b = static_cast<std::uint8_t>(rng());
+
+    BenchReport report;
+    std::string err;
+    report.add("total_data", static_cast<double>(total_bytes) / (1024.0 * 1024.0), "MiB");
+
+    // ---- build ----------------------------------------------------------
+    MiniPackBuilder builder;
+    auto t0 = Clock::now();
+    if (!populate_builder(builder, names, sizes, payload, err)) {
+        std::cerr << "Error: " << err << "\n";
+        return 1;
+    }
+    report.add("builder_add_entries", bench_seconds_since(t0) * 1e3, "ms");
+
+    {
+        // Borrowed entries reference the shared payload instead of copying it
+        MiniPackBuilder borrowed;
+        borrowed.reserve(names.size());
+        auto t = Clock::now();
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            if (!borrowed.add_entry_borrowed(names[i], std::span<const std::uint8_t>(payload.data(), sizes[i]), err)) {
+                std::cerr << "Error: " << err << "\n";
+                return 1;
+            }
+        }
+        report.add("builder_add_entries_borrowed", bench_seconds_since(t) * 1e3, "ms");
+    }
+
+    {
+        // Arena mode copies names and payloads into shared chunks
+        MiniPackBuilder arena;
+        arena.enable_arena();
+        arena.reserve(names.size());
+        auto t = Clock::now();
+        if (!populate_builder(arena, names, sizes, payload, err)) {
+            std::cerr << "Error: " << err << "\n";
+            return 1;
+        }
+        report.add("builder_add_entries_arena", bench_seconds_since(t) * 1e3, "ms");
+
+        std::vector<std::uint8_t> image;
+        auto writer = create_vector_writer(image);
+        MiniPackBuildResult result{};
+        t = Clock::now();
+        if (!arena.build_pack(writer.get(), false, result, err)) {
+            std::cerr << "Error: " << err << "\n";
+            return 1;
+        }
+        report.add("build_pack_memory_arena", bench_seconds_since(t) * 1e3, "ms");
+    }
+
+    {
+        double best = 0.0;
+        for (std::uint32_t it = 0; it < cfg.iterations; ++it) {
+            std::vector<std::uint8_t> image;
+            auto writer = create_vector_writer(image);
+            MiniPackBuildResult result{};
+            auto t = Clock::now();
+            if (!builder.build_pack(writer.get(), false, result, err)) {
+                std::cerr << "Error: " << err << "\n";
+                return 1;
+            }
+            double s = bench_seconds_since(t);
+            if (it == 0 || s < best) best = s;
+        }
+        report.add("build_pack_memory", best * 1e3, "ms");
+        report.add("build_pack_memory_throughput", bench_mb_per_s(total_bytes, best), "MiB/s");
+    }
+
+    {
+        double best = 0.0;
+        for (std::uint32_t it = 0; it < cfg.iterations; ++it) {
+            MiniPackImage image;
+            MiniPackBuildResult result{};
+            auto t = Clock::now();
+            if (!builder.build_pack_image(image, false, result, err)) {
+                std::cerr << "Error: " << err << "\n";
+                return 1;
+            }
+            double s = bench_seconds_since(t);
+            if (it == 0 || s < best) best = s;
+        }
+        report.add("build_pack_image", best * 1e3, "ms");
+        report.add("build_pack_image_throughput", bench_mb_per_s(total_bytes, best), "MiB/s");
+    }
+
+    {
+        double best = 0.0;
+        MiniPackWriterStats write_stats{};
+        for (std::uint32_t it = 0; it < cfg.iterations; ++it) {
+            MiniPackBuildResult result{};
+            write_stats = MiniPackWriterStats{};
+            MiniPackFileWriterOptions options;
+            options.stats = &write_stats;
+            auto t = Clock::now();
+            {
+                auto writer = create_file_writer(pack_path, options);
+                if (!writer) {
+                    std::cerr << "Failed to open output file: " << pack_path << "\n";
+                    return 1;
+                }
+                if (!builder.build_pack(writer.get(), false, result, err)) {
+                    std::cerr << "Error: " << err << "\n";
+                    return 1;
+                }
+            }
+            double s = bench_seconds_since(t);
+            if (it == 0 || s < best) best = s;
+        }
+        report.add("build_pack_file", best * 1e3, "ms");
+        report.add("build_pack_file_throughput", bench_mb_per_s(total_bytes, best), "MiB/s");
+        report.add("build_pack_file_os_writes", static_cast<double>(write_stats.os_write_calls), "calls");
+        report.add("build_pack_file_write_rate", write_stats.bytes_per_second() / (1024.0 * 1024.0), "MiB/s");
+    }
+    // Same index with front-coded names (index only; the data area is irrelevant here)
+    const std::string fc_path = pack_path + ".fc";
+    builder.set_front_coded_names(true);
+    {
+        auto writer = create_file_writer(fc_path);
+        MiniPackBuildResult result{};
+        if (!writer || !builder.build_pack(writer.get(), true, result, err)) {
+            std::cerr << "Error: " << (writer ? err : "failed to open " + fc_path) << "\n";
+            return 1;
+        }
+    }
+
+    builder.clear();
+
+    // ---- index load -----------------------------------------------------
+    MiniPackIndex index;
+    {
+        double best = 0.0;
+        for (std::uint32_t it = 0; it < cfg.iterations; ++it) {
+            auto t = Clock::now();
+            if (!load_minipack_index(pack_path, index, err)) {
+                std::cerr << "Error: " << err << "\n";
+                return 1;
+            }
+            double s = bench_seconds_since(t);
+            if (it == 0 || s < best) best = s;
+        }
+        report.add("index_load", best * 1e3, "ms");
+        report.add("index_info_size", static_cast<double>(index.info_size()), "bytes");
+    }
+
+    {
+        MiniPackIndex fc_index;
+        double best = 0.0;
+        for (std::uint32_t it = 0; it < cfg.iterations; ++it) {
+            auto t = Clock::now();
+            if (!load_minipack_index(fc_path, fc_index, err)) {
+                std::cerr << "Error: " << err << "\n";
+                return 1;
+            }
+            double s = bench_seconds_since(t);
+            if (it == 0 || s < best) best = s;
+        }
+        report.add("index_load_front_coded", best * 1e3, "ms");
+        report.add("index_info_size_front_coded", static_cast<double>(fc_index.info_size()), "bytes");
+        std::filesystem::remove(fc_path, ec);
+    }
+
+    // ---- lookup latency -------------------------------------------------
+    {
+        std::uniform_int_distribution<std::uint32_t> pick(0, cfg.entries - 1);
+        std::vector<double> lat;
+        lat.reserve(cfg.lookups);
+        std::size_t found = 0;
+        for (std::uint32_t i = 0; i < cfg.lookups; ++i) {
+            const std::string &key = names[pick(rng)];
+            auto t = Clock::now();
+            const MiniPackEntry *e = index.find(key);
+            lat.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t).count());
+            if (e) ++found;
+        }
+        if (found != cfg.lookups) {
+            std::cerr << "Error: lookup missed " << (cfg.lookups - found) << " names\n";
+            return 1;
+        }
+        std::sort(lat.begin(), lat.end());
+        report.add("lookup_p50", percentile(lat, 0.50), "us");
+        report.add("lookup_p90", percentile(lat, 0.90), "us");
+        report.add("lookup_p99", percentile(lat, 0.99), "us");
+        report.add("lookup_max", lat.empty() ? 0.0 : lat.back(), "us");
+
+        // Directory listing and prefix queries over the sorted name order
+        std::vector<MiniPackDirEntry> children;
+        std::size_t listed = 0;
+        auto t = Clock::now();
+        for (std::uint32_t d = 0; d < 64; ++d) {
+            index.list_directory("dir" + std::to_string(d), children);
+            listed += children.size();
+        }
+        report.add("list_directory_x64", bench_seconds_since(t) * 1e6, "us");
+        std::size_t matched = 0;
+        t = Clock::now();
+        for (std::uint32_t d = 0; d < 64; ++d) matched += index.with_prefix("dir" + std::to_string(d) + "/sub3/").size();
+        report.add("prefix_query_x64", bench_seconds_since(t) * 1e6, "us");
+        if (listed == 0 && matched == 0 && cfg.entries > 0) {
+            std::cerr << "Error: directory queries returned nothing\n";
+            return 1;
+        }
+    }
+
+    // ---- reads ----------------------------------------------------------
+    {
+        const auto &entries = index.entries();
+        std::vector<std::uint8_t> buf;
+        auto t = Clock::now();
+        for (const auto &e : entries) {
+            if (!read_minipack_entry_data(pack_path, e, buf, err)) {
+                std::cerr << "Error: " << err << "\n";
+                return 1;
+            }
+        }
+        double s = bench_seconds_since(t);
+        report.add("read_sequential", s * 1e3, "ms");
+        report.add("read_sequential_throughput", bench_mb_per_s(total_bytes, s), "MiB/s");
+
+        std::uniform_int_distribution<std::size_t> pick(0, entries.size() - 1);
+        std::uint64_t bytes = 0;
+        t = Clock::now();
+        for (std::uint32_t i = 0; i < cfg.random_reads; ++i) {
+            const auto &e = entries[pick(rng)];
+            if (!read_minipack_entry_data(pack_path, e, buf, err)) {
+                std::cerr << "Error: " << err << "\n";
+                return 1;
+            }
+            bytes += e.size;
+        }
+        s = bench_seconds_since(t);
+        report.add("read_random", s * 1e3, "ms");
+        report.add("read_random_throughput", bench_mb_per_s(bytes, s), "MiB/s");
+        report.add("read_random_ops", s > 0.0 ? cfg.random_reads / s : 0.0, "ops/s");
+    }
+
+    {
+        // Random reads served in place from a mapping of the pack
+        MiniPackMappedFile mapped;
+        MiniPackMemoryReader reader;
+        auto t = Clock::now();
+        if (!mapped.open(pack_path, err) || !reader.open(mapped.bytes(), err)) {
+            std::cerr << "Error: " << err << "\n";
+            return 1;
+        }
+        report.add("mapped_open", bench_seconds_since(t) * 1e3, "ms");
+
+        const auto &entries = reader.index().entries();
+        std::mt19937_64 map_rng(cfg.seed ^ 0x5bd1e995u);
+        std::uniform_int_distribution<std::size_t> pick(0, entries.size() - 1);
+        std::vector<std::uint8_t> copy;
+        std::uint64_t bytes = 0;
+        t = Clock::now();
+        for (std::uint32_t i = 0; i < cfg.random_reads; ++i) {
+            std::span<const std::uint8_t> view;
+            if (!reader.entry_bytes(entries[pick(map_rng)], view, err)) {
+                std::cerr << "Error: " << err << "\n";
+                return 1;
+            }
+            // Copy out so the figure is comparable with read_random
+            copy.assign(view.begin(), view.end());
+            bytes += view.size();
+        }
+        double s = bench_seconds_since(t);
+        report.add("read_mapped_random", s * 1e3, "ms");
+        report.add("read_mapped_random_throughput", bench_mb_per_s(bytes, s), "MiB/s");
+        report.add("read_mapped_random_ops", s > 0.0 ? cfg.random_reads / s : 0.0, "ops/s");
+    }
+
+    if (cfg.utf_mb > 0) bench_utf_converters(report, cfg.utf_mb, cfg.seed);
+    if (cfg.text_mb > 0) bench_text_decoding(report, dir.string(), cfg.text_mb, cfg.seed);
+    if (cfg.list_lines > 0) bench_file_list(report, dir.string(), cfg.list_lines);
+
+    if (cfg.json) print_json(std::cout, report, cfg);
+    else report.print_text(std::cout);
+
+    if (!cfg.keep) {
+        if (cfg.work_dir.empty()) std::filesystem::remove_all(dir, ec);
+        else std::filesystem::remove(pack_path, ec);
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Shared helpers for the minipack_bench sections.
+
+using BenchClock = std::chrono::steady_clock;
+
+struct BenchMetric
+{
+    std::string name;
+    double value = 0.0;
+    std::string unit;
+};
+
+class BenchReport
+{
+public:
+    void add(const std::string &name, double value, const std::string &unit) { m_metrics.push_back(BenchMetric{name, value, unit}); }
+
+    const std::vector<BenchMetric> &metrics() const { return m_metrics; }
+
+    void print_text(std::ostream &os) const
+    {
+        for (const auto &m : m_metrics) {
+            os << std::left << std::setw(36) << m.name << std::right << std::setw(16) << std::fixed << std::setprecision(3) << m.value << " " << m.unit << "\n";
+        }
+    }
+
+private:
+    std::vector<BenchMetric> m_metrics;
+};
+
+inline double bench_seconds_since(BenchClock::time_point start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+inline double bench_mb_per_s(std::uint64_t bytes, double seconds)
+{
+    if (seconds <= 0.0) return 0.0;
+    return static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds;
+}
+
+// UTF converter throughput, SIMD dispatch vs. the scalar reference (minipack_bench_utf.cpp).
+void bench_utf_converters(BenchReport &report, std::size_t megabytes, std::uint64_t seed);
+
+// read_text_file_as_utf8 throughput on generated UTF-8 and UTF-16LE files in 'dir'.
+void bench_text_decoding(BenchReport &report, const std::string &dir, std::size_t megabytes, std::uint64_t seed);
+
+// File list parsing throughput for a generated list of 'lines' entries (minipack_bench_input.cpp).
+void bench_file_list(BenchReport &report, const std::string &dir, std::size_t lines);
+
+// Exhaustive equivalence check of the UTF fast paths against the scalar
+// reference converters, for every kernel set the CPU supports.
+bool verify_utf_equivalence(std::ostream &log);
@@ -0,0 +1,62 @@
+﻿#include "minipack_bench.h"
+#include "file_list_reader.h"
+
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+// Input-side sections: file list parsing.
+
+void bench_file_list(BenchReport &report, const std::string &dir, std::size_t lines)
+{
+    std::string content;
+    content.reserve(lines * 48);
+    for (std::size_t i = 0; i < lines; ++i) {
+        if (i % 1000 == 0) content += "# generated block\n";
+        content += "  assets/models/chunk_";
+        content += std::to_string(i / 1000);
+        content += "/mesh_";
+        content += std::to_string(i);
+        content += ".bin";
+        // Every fourth line renames the entry inside the pack
+        if (i % 4 == 0) {
+            content += "\tmesh/";
+            content += std::to_string(i);
+        }
+        content += "\r\n";
+    }
+
+    const std::string path = (std::filesystem::path(dir) / "file_list.txt").string();
+    {
+        std::ofstream f(path, std::ios::binary);
+        f.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }
+
+    std::vector<std::pair<std::string, std::string>> pairs;
+    double best_parse = 0.0;
+    double best_read = 0.0;
+    for (int it = 0; it < 3; ++it) {
+        pairs.clear();
+        pairs.shrink_to_fit();
+        auto t = BenchClock::now();
+        parse_file_list(content, pairs);
+        double s = bench_seconds_since(t);
+        if (it == 0 || s < best_parse) best_parse = s;
+
+        pairs.clear();
+        pairs.shrink_to_fit();
+        std::string err;
+        t = BenchClock::now();
+        if (!read_file_list_pairs(path, pairs, err)) break;
+        s = bench_seconds_since(t);
+        if (it == 0 || s < best_read) best_read = s;
+    }
+
+    report.add("file_list_lines", static_cast<double>(pairs.size()), "lines");
+    report.add("file_list_parse", best_parse * 1e3, "ms");
+    report.add("file_list_parse_rate", best_parse > 0.0 ? static_cast<double>(lines) / best_parse / 1e6 : 0.0, "Mlines/s");
+    report.add("file_list_read_and_parse", best_read * 1e3, "ms");
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+}
@@ -0,0 +1,325 @@
+﻿#include "minipack_bench.h"
+#include "utf_conv.h"
+#include "utf_simd.h"
+#include "encoding.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace {
+
+// ---- equivalence --------------------------------------------------------
+
+class UtfChecker
+{
+public:
+    explicit UtfChecker(std::ostream &log) : m_log(log) {}
+
+    void set_kernel(const char *name) { m_kernel = name; }
+
+    void utf8(const std::string &in)
+    {
+        // Both converters clear 'out' first; seed it anyway so partial results compare
+        m_u16a.assign(1, u'?');
+        m_u16b.assign(1, u'?');
+        const bool ra = utf8_to_utf16(in, m_u16a);
+        const bool rb = utf8_to_utf16_scalar(in, m_u16b);
+        record(ra == rb && m_u16a == m_u16b, "utf8_to_utf16", reinterpret_cast<const std::uint8_t*>(in.data()), in.size());
+    }
+
+    void utf16_bytes(const std::uint8_t *data, std::size_t size)
+    {
+        compare8(utf16le_bytes_to_utf8, utf16le_bytes_to_utf8_scalar, "utf16le_bytes_to_utf8", data, size);
+        compare8(utf16be_bytes_to_utf8, utf16be_bytes_to_utf8_scalar, "utf16be_bytes_to_utf8", data, size);
+        if (size % 2 == 0) {
+            m_u16in.resize(size / 2);
+            if (size) std::memcpy(m_u16in.data(), data, size);
+            m_a.assign(1, '?');
+            m_b.assign(1, '?');
+            const bool ra = utf16_string_to_utf8(m_u16in, m_a);
+            const bool rb = utf16_string_to_utf8_scalar(m_u16in, m_b);
+            record(ra == rb && m_a == m_b, "utf16_string_to_utf8", data, size);
+        }
+    }
+
+    void utf32_bytes(const std::uint8_t *data, std::size_t size)
+    {
+        compare8(utf32le_bytes_to_utf8, utf32le_bytes_to_utf8_scalar, "utf32le_bytes_to_utf8", data, size);
+        compare8(utf32be_bytes_to_utf8, utf32be_bytes_to_utf8_scalar, "utf32be_bytes_to_utf8", data, size);
+    }
+
+    std::uint64_t cases() const { return m_cases; }
+    std::uint64_t failures() const { return m_failures; }
+
+private:
+    using Conv8 = bool (*)(const std::uint8_t*, std::size_t, std::string&);
+
+    void compare8(Conv8 fast, Conv8 ref, const char *what, const std::uint8_t *data, std::size_t size)
+    {
+        m_a.assign(1, '?');
+        m_b.assign(1, '?');
+        const bool ra = fast(data, size, m_a);
+        const bool rb = ref(data, size, m_b);
+        record(ra == rb && m_a == m_b, what, data, size);
+    }
+
+    void record(bool ok, const char *what, const std::uint8_t *data, std::size_t size)
+    {
+        ++m_cases;
+        if (ok) return;
+        if (++m_failures <= 10) {
+            m_log << "MISMATCH [" << m_kernel << "] " << what << " input(" << size << "):";
+            for (std::size_t i = 0; i < size && i < 48; ++i) m_log << " " << std::hex << static_cast<int>(data[i]) << std::dec;
+            m_log << "\n";
+        }
+    }
+
+    std::ostream &m_log;
+    const char *m_kernel = "";
+    std::uint64_t m_cases = 0;
+    std::uint64_t m_failures = 0;
+    std::u16string m_u16a, m_u16b, m_u16in;
+    std::string m_a, m_b;
+};
+
+// Surround 'seq' with ASCII so the sequence lands past one and across the next vector block
+void embed(std::vector<std::uint8_t> &buf, const std::uint8_t *seq, std::size_t seq_len, std::size_t unit, std::size_t prefix_units, std::size_t suffix_units, bool big_endian)
+{
+    buf.clear();
+    auto put_ascii = [&](std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::uint8_t c = static_cast<std::uint8_t>('a' + i % 26);
+            for (std::size_t b = 0; b < unit; ++b) {
+                const bool low = big_endian ? (b == unit - 1) : (b == 0);
+                buf.push_back(low ? c : 0);
+            }
+        }
+    };
+    put_ascii(prefix_units);
+    buf.insert(buf.end(), seq, seq + seq_len);
+    put_ascii(suffix_units);
+}
+
+void check_utf8_all(UtfChecker &c)
+{
+    std::string s;
+    std::vector<std::uint8_t> buf;
+    std::uint8_t seq[4];
+
+    // Every 1-, 2- and 3-byte sequence
+    for (std::uint32_t v = 0; v < 0x100; ++v) {
+        seq[0] = static_cast<std::uint8_t>(v);
+        s.assign(1, static_cast<char>(seq[0]));
+        c.utf8(s);
+        embed(buf, seq, 1, 1, 37, 29, false);
+        c.utf8(std::string(buf.begin(), buf.end()));
+    }
+    for (std::uint32_t v = 0; v < 0x10000; ++v) {
+        seq[0] = static_cast<std::uint8_t>(v >> 8);
+        seq[1] = static_cast<std::uint8_t>(v);
+        s.assign(reinterpret_cast<const char*>(seq), 2);
+        c.utf8(s);
+        embed(buf, seq, 2, 1, 31, 33, false);
+        c.utf8(std::string(buf.begin(), buf.end()));
+    }
+    for (std::uint32_t v = 0; v < 0x1000000; ++v) {
+        seq[0] = static_cast<std::uint8_t>(v >> 16);
+        seq[1] = static_cast<std::uint8_t>(v >> 8);
+        seq[2] = static_cast<std::uint8_t>(v);
+        s.assign(reinterpret_cast<const char*>(seq), 3);
+        c.utf8(s);
+    }
+    // 4-byte sequences: every lead from 0xF0 and second byte, boundary values for the rest
+    static const std::uint8_t kEdges[] = {0x00, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0, 0xFF};
+    for (std::uint32_t b0 = 0xF0; b0 < 0x100; ++b0) {
+        for (std::uint32_t b1 = 0; b1 < 0x100; ++b1) {
+            for (std::uint8_t b2 : kEdges) {
+                for (std::uint8_t b3 : kEdges) {
+                    seq[0] = static_cast<std::uint8_t>(b0);
+                    seq[1] = static_cast<std::uint8_t>(b1);
+                    seq[2] = b2;
+                    seq[3] = b3;
+                    s.assign(reinterpret_cast<const char*>(seq), 4);
+                    c.utf8(s);
+                    embed(buf, seq, 4, 1, 47, 17, false);
+                    c.utf8(std::string(buf.begin(), buf.end()));
+                }
+            }
+        }
+    }
+}
+
+void check_utf16_all(UtfChecker &c)
+{
+    std::vector<std::uint8_t> buf;
+    std::uint8_t seq[4];
+
+    // Every single unit, standalone and inside ASCII context, in both byte orders
+    for (std::uint32_t v = 0; v < 0x10000; ++v) {
+        seq[0] = static_cast<std::uint8_t>(v);
+        seq[1] = static_cast<std::uint8_t>(v >> 8);
+        c.utf16_bytes(seq, 2);
+        c.utf16_bytes(seq, 1);
+        embed(buf, seq, 2, 2, 33, 20, false);
+        c.utf16_bytes(buf.data(), buf.size());
+        embed(buf, seq, 2, 2, 33, 20, true);
+        c.utf16_bytes(buf.data(), buf.size());
+    }
+    // Every high surrogate followed by every low surrogate, plus non-surrogate followers
+    for (std::uint32_t hi = 0xD800; hi <= 0xDBFF; ++hi) {
+        for (std::uint32_t lo = 0xDC00; lo <= 0xDFFF; ++lo) {
+            seq[0] = static_cast<std::uint8_t>(hi);
+            seq[1] = static_cast<std::uint8_t>(hi >> 8);
+            seq[2] = static_cast<std::uint8_t>(lo);
+            seq[3] = static_cast<std::uint8_t>(lo >> 8);
+            c.utf16_bytes(seq, 4);
+        }
+        for (std::uint32_t lo : {0x0000u, 0x0041u, 0x00E9u, 0xD7FFu, 0xD800u, 0xDBFFu, 0xE000u, 0xFFFFu}) {
+            seq[0] = static_cast<std::uint8_t>(hi);
+            seq[1] = static_cast<std::uint8_t>(hi >> 8);
+            seq[2] = static_cast<std::uint8_t>(lo);
+            seq[3] = static_cast<std::uint8_t>(lo >> 8);
+            c.utf16_bytes(seq, 4);
+            c.utf16_bytes(seq, 3);
+        }
+    }
+}
+
+void check_utf32_all(UtfChecker &c)
+{
+    std::vector<std::uint8_t> buf;
+    std::uint8_t seq[4];
+    auto one = [&](std::uint32_t v, bool context) {
+        seq[0] = static_cast<std::uint8_t>(v);
+        seq[1] = static_cast<std::uint8_t>(v >> 8);
+        seq[2] = static_cast<std::uint8_t>(v >> 16);
+        seq[3] = static_cast<std::uint8_t>(v >> 24);
+        c.utf32_bytes(seq, 4);
+        if (!context) return;
+        embed(buf, seq, 4, 4, 11, 9, false);
+        c.utf32_bytes(buf.data(), buf.size());
+        embed(buf, seq, 4, 4, 11, 9, true);
+        c.utf32_bytes(buf.data(), buf.size());
+    };
+    for (std::uint32_t v = 0; v <= 0x10FFFF; ++v) one(v, v < 0x800 || (v & 0xFFF) == 0);
+    for (std::uint32_t v : {0x110000u, 0x7FFFFFFFu, 0x80000000u, 0xFFFFFFFFu, 0x00800000u, 0x80000041u, 0x41000000u}) one(v, true);
+    c.utf32_bytes(seq, 3);
+}
+
+void check_random(UtfChecker &c, std::uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::vector<std::uint8_t> buf;
+    for (int iter = 0; iter < 200000; ++iter) {
+        const std::size_t len = rng() % 200;
+        buf.resize(len);
+        const unsigned mode = static_cast<unsigned>(rng() % 4);
+        for (auto &b : buf) {
+            const std::uint64_t r = rng();
+            // Mostly ASCII, with occasional high bytes / zero bytes
+            b = (mode == 0 || r % 16 == 0) ? static_cast<std::uint8_t>(r >> 8) : (r % 5 == 0 ? 0 : static_cast<std::uint8_t>((r >> 8) & 0x7F));
+        }
+        c.utf8(std::string(buf.begin(), buf.end()));
+        c.utf16_bytes(buf.data(), buf.size());
+        c.utf32_bytes(buf.data(), buf.size());
+    }
+}
+
+std::string make_mixed_text(std::size_t bytes, std::uint64_t seed)
+{
+    // File-list-like text: ASCII paths with the occasional non-ASCII name
+    std::mt19937_64 rng(seed);
+    std::string text;
+    text.reserve(bytes + 64);
+    std::size_t line = 0;
+    while (text.size() < bytes) {
+        text += "assets/textures/ui/panel_";
+        text += std::to_string(line);
+        if (rng() % 16 == 0) text += "_\xE5\x9B\xBE\xE7\x89\x87"; // 图片
+        text += ".png\n";
+        ++line;
+    }
+    return text;
+}
+
+} // namespace
+
+bool verify_utf_equivalence(std::ostream &log)
+{
+    UtfChecker checker(log);
+    for (const auto *k : minipack_utf_simd::available_kernels()) {
+        minipack_utf_simd::force_kernels(k);
+        checker.set_kernel(k->name);
+        const std::uint64_t before = checker.cases();
+        check_utf8_all(checker);
+        check_utf16_all(checker);
+        check_utf32_all(checker);
+        check_random(checker, 42);
+        log << "kernel " << k->name << ": " << (checker.cases() - before) << " cases\n";
+    }
+    minipack_utf_simd::force_kernels(nullptr);
+    log << "utf equivalence: " << checker.cases() << " cases, " << checker.failures() << " mismatches\n";
+    return checker.failures() == 0;
+}
+
+void bench_utf_converters(BenchReport &report, std::size_t megabytes, std::uint64_t seed)
+{
+    const std::string text = make_mixed_text(megabytes * 1024 * 1024, seed);
+    std::u16string u16;
+    std::string back;
+    if (!utf8_to_utf16(text, u16)) return;
+    const std::uint8_t *u16_bytes = reinterpret_cast<const std::uint8_t*>(u16.data());
+
+    auto run = [&](const char *name, auto &&fn) {
+        double best = 0.0;
+        for (int it = 0; it < 3; ++it) {
+            auto t = BenchClock::now();
+            fn();
+            const double s = bench_seconds_since(t);
+            if (it == 0 || s < best) best = s;
+        }
+        report.add(name, bench_mb_per_s(text.size(), best), "MiB/s");
+    };
+
+    run("utf8_to_utf16", [&] { utf8_to_utf16(text, u16); });
+    run("utf8_to_utf16_scalar", [&] { utf8_to_utf16_scalar(text, u16); });
+    run("utf16le_to_utf8", [&] { utf16le_bytes_to_utf8(u16_bytes, u16.size() * 2, back); });
+    run("utf16le_to_utf8_scalar", [&] { utf16le_bytes_to_utf8_scalar(u16_bytes, u16.size() * 2, back); });
+}
+
+void bench_text_decoding(BenchReport &report, const std::string &dir, std::size_t megabytes, std::uint64_t seed)
+{
+    const std::string text = make_mixed_text(megabytes * 1024 * 1024, seed);
+    std::u16string u16;
+    if (!utf8_to_utf16(text, u16)) return;
+
+    const std::string utf8_path = (std::filesystem::path(dir) / "list_utf8.txt").string();
+    const std::string utf16_path = (std::filesystem::path(dir) / "list_utf16le.txt").string();
+    {
+        std::ofstream f8(utf8_path, std::ios::binary);
+        f8.write(text.data(), static_cast<std::streamsize>(text.size()));
+        std::ofstream f16(utf16_path, std::ios::binary);
+        f16.write("\xFF\xFE", 2);
+        f16.write(reinterpret_cast<const char*>(u16.data()), static_cast<std::streamsize>(u16.size() * 2));
+    }
+
+    auto run = [&](const char *name, const std::string &path, std::uint64_t bytes) {
+        std::string out;
+        double best = 0.0;
+        for (int it = 0; it < 3; ++it) {
+            auto t = BenchClock::now();
+            if (!read_text_file_as_utf8(path, out)) return;
+            const double s = bench_seconds_since(t);
+            if (it == 0 || s < best) best = s;
+        }
+        report.add(name, bench_mb_per_s(bytes, best), "MiB/s");
+    };
+    run("read_text_utf8", utf8_path, text.size());
+    run("read_text_utf16le", utf16_path, u16.size() * 2 + 2);
+
+    std::error_code ec;
+    std::filesystem::remove(utf8_path, ec);
+    std::filesystem::remove(utf16_path, ec);
+}
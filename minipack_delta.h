@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Delta file produced by minipack_diff and applied by minipack_patch.
+//
+//   char[8] magic "MPDelta1"
+//   u64 old_size, u64 old_header_size, u64 old_header_hash   (FNV-1a of old[0, old_header_size))
+//   u64 new_size, u64 new_hash                                (FNV-1a of the whole new pack)
+//   ops until kOpEnd:
+//     kOpCopy  u64 old_offset, u64 length   copy a range of the old pack
+//     kOpData  u64 length, u8[length]       literal bytes
+//     kOpEnd
+//
+// All integers are little-endian. The new pack is the concatenation of the ops.
+
+namespace minipack_delta {
+
+inline constexpr char kMagic[8] = {'M', 'P', 'D', 'e', 'l', 't', 'a', '1'};
+inline constexpr std::size_t kHeaderSize = 8 + 5 * 8;
+
+inline constexpr std::uint8_t kOpCopy = 'C';
+inline constexpr std::uint8_t kOpData = 'D';
+inline constexpr std::uint8_t kOpEnd = 'E';
+
+struct Header
+{
+    std::uint64_t old_size = 0;
+    std::uint64_t old_header_size = 0;
+    std::uint64_t old_header_hash = 0;
+    std::uint64_t new_size = 0;
+    std::uint64_t new_hash = 0;
+};
+
+inline void append_u64_le(std::vector<std::uint8_t> &buf, std::uint64_t v)
+{
+    for (int i = 0; i < 8; ++i) buf.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+}
+
+inline std::uint64_t read_u64_le_8(const std::uint8_t *b)
+{
+    std::uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | b[i];
+    return v;
+}
+
+inline void append_header(std::vector<std::uint8_t> &buf, const Header &h)
+{
+    buf.insert(buf.end(), kMagic, kMagic + sizeof(kMagic));
+    append_u64_le(buf, h.old_size);
+    append_u64_le(buf, h.old_header_size);
+    append_u64_le(buf, h.old_header_hash);
+    append_u64_le(buf, h.new_size);
+    append_u64_le(buf, h.new_hash);
+}
+
+}
@@ -0,0 +1,232 @@
+﻿#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mini_pack_builder.h"
+#include "minipack_delta.h"
+#include "minipack_hash.h"
+#include "pack_reader_memory.h"
+
+// Compare two packs by entry name and content and write a delta that rebuilds
+// the new pack from the old one: entries found unchanged in the old pack (by
+// name, or by content anywhere in it) become range copies, everything else is
+// embedded literally.
+
+namespace {
+
+// Accumulates ops, merging adjacent copies of contiguous old ranges and
+// literals that are contiguous in the new pack.
+class DeltaEmitter
+{
+public:
+    explicit DeltaEmitter(MiniPackWriter *writer) : m_writer(writer) {}
+
+    bool copy(std::uint64_t old_offset, std::uint64_t length, std::string &err)
+    {
+        if (length == 0) return true;
+        m_copy_bytes += length;
+        if (m_kind == minipack_delta::kOpCopy && m_copy_offset + m_length == old_offset) {
+            m_length += length;
+            return true;
+        }
+        if (!flush_pending(err)) return false;
+        m_kind = minipack_delta::kOpCopy;
+        m_copy_offset = old_offset;
+        m_length = length;
+        return true;
+    }
+
+    bool data(const std::uint8_t *bytes, std::uint64_t length, std::string &err)
+    {
+        if (length == 0) return true;
+        m_data_bytes += length;
+        if (m_kind == minipack_delta::kOpData && m_data + m_length == bytes) {
+            m_length += length;
+            return true;
+        }
+        if (!flush_pending(err)) return false;
+        m_kind = minipack_delta::kOpData;
+        m_data = bytes;
+        m_length = length;
+        return true;
+    }
+
+    bool finish(std::string &err)
+    {
+        if (!flush_pending(err)) return false;
+        const std::uint8_t end = minipack_delta::kOpEnd;
+        return m_writer->write(&end, 1, err) && m_writer->flush(err);
+    }
+
+    std::uint64_t copy_bytes() const { return m_copy_bytes; }
+    std::uint64_t data_bytes() const { return m_data_bytes; }
+    std::uint64_t op_count() const { return m_ops; }
+
+private:
+    bool flush_pending(std::string &err)
+    {
+        if (m_kind == 0) return true;
+        std::vector<std::uint8_t> op;
+        op.push_back(m_kind);
+        if (m_kind == minipack_delta::kOpCopy) minipack_delta::append_u64_le(op, m_copy_offset);
+        minipack_delta::append_u64_le(op, m_length);
+        if (!m_writer->write(op.data(), op.size(), err)) return false;
+        if (m_kind == minipack_delta::kOpData && !m_writer->write(m_data, static_cast<std::size_t>(m_length), err)) return false;
+        ++m_ops;
+        m_kind = 0;
+        return true;
+    }
+
+    MiniPackWriter *m_writer;
+    std::uint8_t m_kind = 0;
+    std::uint64_t m_copy_offset = 0;
+    const std::uint8_t *m_data = nullptr;
+    std::uint64_t m_length = 0;
+    std::uint64_t m_copy_bytes = 0;
+    std::uint64_t m_data_bytes = 0;
+    std::uint64_t m_ops = 0;
+};
+
+bool open_pack(const std::string &path, MiniPackMappedFile &mapped, MiniPackMemoryReader &reader, std::string &err)
+{
+    return mapped.open(path, err) && reader.open(mapped.bytes(), err);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 4) {
+        std::cout << "Usage: " << argv[0] << " <old.pack> <new.pack> <out.delta>\n";
+        return 1;
+    }
+    const std::string old_path = argv[1];
+    const std::string new_path = argv[2];
+    const std::string out_path = argv[3];
+    std::string err;
+
+    // The packs stay mapped while the delta is written, so it must be a different file
+    std::error_code ec;
+    if (std::filesystem::equivalent(out_path, old_path, ec) || std::filesystem::equivalent(out_path, new_path, ec)) {
+        std::cerr << "Error: output must not be one of the inputs: " << out_path << "\n";
+        return 1;
+    }
+
+    MiniPackMappedFile old_map, new_map;
+    MiniPackMemoryReader old_pack, new_pack;
+    if (!open_pack(old_path, old_map, old_pack, err) || !open_pack(new_path, new_map, new_pack, err)) {
+        std::cerr << "Error: " << err << "\n";
+        return 1;
+    }
+    // Deltas cover single-file packs only; volume data lives outside the mapped files
+    for (const auto *p : {&old_pack, &new_pack}) {
+        if (p->index().volume_count() > 0) {
+            std::cerr << "Error: multi-volume packs are not supported: " << (p == &old_pack ? old_path : new_path) << "\n";
+            return 1;
+        }
+    }
+    const std::span<const std::uint8_t> old_bytes = old_map.bytes();
+    const std::span<const std::uint8_t> new_bytes = new_map.bytes();
+
+    minipack_delta::Header header;
+    header.old_size = old_bytes.size();
+    header.old_header_size = std::min<std::uint64_t>(old_pack.index().data_start(), old_bytes.size());
+    header.old_header_hash = minipack_hash::fnv1a64(old_bytes.data(), static_cast<std::size_t>(header.old_header_size));
+    header.new_size = new_bytes.size();
+    header.new_hash = minipack_hash::fnv1a64(new_bytes.data(), new_bytes.size());
+
+    // Write beside the destination and replace it only once the delta is complete
+    const std::string tmp_path = out_path + ".tmp";
+    auto writer = create_file_writer(tmp_path);
+    if (!writer) {
+        std::cerr << "Failed to open output file: " << tmp_path << "\n";
+        return 1;
+    }
+    auto fail = [&]() {
+        writer.reset();
+        std::filesystem::remove(tmp_path, ec);
+        std::cerr << "Error: " << err << "\n";
+        return 1;
+    };
+    std::vector<std::uint8_t> head;
+    minipack_delta::append_header(head, header);
+    if (!writer->write(head.data(), head.size(), err)) return fail();
+
+    // New entries in data-area order, so the ops walk the new pack front to back
+    std::vector<const MiniPackEntry*> order;
+    order.reserve(new_pack.index().file_count());
+    for (const auto &e : new_pack.index().entries())
+        if (e.size > 0) order.push_back(&e);
+    std::sort(order.begin(), order.end(), [](const MiniPackEntry *a, const MiniPackEntry *b) { return a->offset < b->offset; });
+
+    // Old contents by hash, built on the first entry that has no same-name match
+    std::unordered_map<std::uint64_t, std::vector<const MiniPackEntry*>> old_by_hash;
+    bool hashed_old = false;
+    auto find_by_content = [&](std::span<const std::uint8_t> bytes) -> const MiniPackEntry* {
+        if (!hashed_old) {
+            for (const auto &e : old_pack.index().entries()) {
+                std::span<const std::uint8_t> ob;
+                if (e.size > 0 && old_pack.entry_bytes(e, ob, err)) old_by_hash[minipack_hash::fnv1a64(ob.data(), ob.size())].push_back(&e);
+            }
+            hashed_old = true;
+        }
+        auto it = old_by_hash.find(minipack_hash::fnv1a64(bytes.data(), bytes.size()));
+        if (it == old_by_hash.end()) return nullptr;
+        for (const MiniPackEntry *e : it->second) {
+            std::span<const std::uint8_t> ob;
+            if (e->size == bytes.size() && old_pack.entry_bytes(*e, ob, err) && std::memcmp(ob.data(), bytes.data(), bytes.size()) == 0) return e;
+        }
+        return nullptr;
+    };
+
+    DeltaEmitter emit(writer.get());
+    std::uint64_t pos = 0;
+    std::size_t by_name = 0, by_content = 0, literal = 0;
+
+    for (const MiniPackEntry *e : order) {
+        std::span<const std::uint8_t> nb;
+        if (!new_pack.entry_bytes(*e, nb, err)) {
+            err = "New pack is truncated or index-only: " + e->name;
+            return fail();
+        }
+        const std::uint64_t begin = static_cast<std::uint64_t>(nb.data() - new_bytes.data());
+        if (begin < pos) {
+            err = "Overlapping entries in new pack: " + e->name;
+            return fail();
+        }
+        // Header, info block and alignment padding are embedded as is
+        if (!emit.data(new_bytes.data() + pos, begin - pos, err)) return fail();
+
+        const MiniPackEntry *match = old_pack.index().find(e->name);
+        std::span<const std::uint8_t> ob;
+        if (match && (match->size != e->size || !old_pack.entry_bytes(*match, ob, err) || std::memcmp(ob.data(), nb.data(), nb.size()) != 0)) match = nullptr;
+        if (match) ++by_name;
+        else if ((match = find_by_content(nb))) ++by_content;
+
+        if (match) {
+            if (!emit.copy(old_pack.index().data_start() + match->offset, match->size, err)) return fail();
+        } else {
+            ++literal;
+            if (!emit.data(nb.data(), nb.size(), err)) return fail();
+        }
+        pos = begin + nb.size();
+    }
+    if (!emit.data(new_bytes.data() + pos, new_bytes.size() - pos, err) || !emit.finish(err)) return fail();
+    writer.reset();
+    std::filesystem::rename(tmp_path, out_path, ec);
+    if (ec) {
+        err = "Failed to replace " + out_path + ": " + ec.message();
+        return fail();
+    }
+
+    std::cout << "Entries   : " << by_name << " unchanged, " << by_content << " found by content, " << literal << " embedded\n";
+    std::cout << "Copied    : " << emit.copy_bytes() << " bytes\n";
+    std::cout << "Embedded  : " << emit.data_bytes() << " bytes\n";
+    std::cout << "Ops       : " << emit.op_count() << "\n";
+    return 0;
+}
@@ -2,12 +2,19 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <string>
 #include <vector>
 
 namespace minipack_format {
 inline constexpr char kMagic[8] = {'M', 'i', 'n', 'i', 'P', 'a', 'c', 'k'};
 inline constexpr std::size_t kMagicSize = sizeof(kMagic);
 inline constexpr std::uint32_t kVersion = 1;
+// v2 adds a u32 flags field after file_count
+inline constexpr std::uint32_t kVersion2 = 2;
+inline constexpr std::uint32_t kFlagFrontCodedNames = 1u << 0;
+// Data lives in volume files: a u32 volume count and a u32 volume per entry follow the size table
+inline constexpr std::uint32_t kFlagVolumes = 1u << 1;
 inline constexpr std::size_t kU32Size = 4;
 inline constexpr std::size_t kInfoSizeOffset = kMagicSize;
 inline constexpr std::size_t kInfoBlockOffset = kMagicSize + kU32Size;
@@ -19,6 +26,13 @@ inline void append_u32_le(std::vector<std::uint8_t> &buf, std::uint32_t v)
     }
 }
 
+inline void write_u32_le(std::uint8_t *b, std::uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) {
+        b[i] = static_cast<std::uint8_t>((v >> (8 * i)) & 0xFF);
+    }
+}
+
 inline std::uint32_t read_u32_le_4(const std::uint8_t *b)
 {
     return static_cast<std::uint32_t>(b[0] | (b[1] << 8) | (b[2] << 16) | (b[3] << 24));
@@ -32,8 +46,24 @@ inline bool read_u32_le(const std::vector<std::uint8_t> &buf, std::size_t &pos,
     return true;
 }
 
+inline bool read_u32_le(const std::uint8_t *buf, std::size_t size, std::size_t &pos, std::uint32_t &out)
+{
+    if (pos + kU32Size > size) return false;
+    out = read_u32_le_4(buf + pos);
+    pos += kU32Size;
+    return true;
+}
+
 inline std::uint64_t data_start_offset(std::uint32_t info_size)
 {
     return static_cast<std::uint64_t>(kInfoBlockOffset) + info_size;
 }
+
+// File holding volume 'volume' (1-based) of a multi-volume pack: "<pack>.001", ...
+inline std::string volume_path(const std::string &pack_path, std::uint32_t volume)
+{
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), ".%03u", static_cast<unsigned>(volume));
+    return pack_path + suffix;
+}
 }
@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a, used to match entry contents between packs and to verify
+// delta patches. Not cryptographic; matches are confirmed byte-wise where it matters.
+
+namespace minipack_hash {
+
+inline constexpr std::uint64_t kFnvOffset = 14695981039346656037ull;
+inline constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+// Incremental form: feed the bytes in any number of pieces.
+struct Fnv1a64
+{
+    std::uint64_t value = kFnvOffset;
+
+    void update(const std::uint8_t *data, std::size_t size)
+    {
+        std::uint64_t h = value;
+        for (std::size_t i = 0; i < size; ++i) {
+            h ^= data[i];
+            h *= kFnvPrime;
+        }
+        value = h;
+    }
+};
+
+inline std::uint64_t fnv1a64(const std::uint8_t *data, std::size_t size)
+{
+    Fnv1a64 h;
+    h.update(data, size);
+    return h.value;
+}
+
+}
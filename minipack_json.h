@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// Minimal JSON output helpers shared by the trace writer and minipack_info --json.
+
+namespace minipack_json {
+
+// Append 's' as a quoted JSON string, escaping quotes, backslashes and control characters
+inline void append_string(std::string &out, std::string_view s)
+{
+    out.push_back('"');
+    for (const char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+                out += buf;
+            } else {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+}
@@ -0,0 +1,172 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "minipack_format.h"
+
+// Front-coded name table (format v2, kFlagFrontCodedNames).
+//
+// Names are grouped in blocks of kNameBlockSize. The first name of a block is
+// stored whole as varint(length) + bytes; every following name stores
+// varint(shared prefix with the previous name) + varint(suffix length) + suffix.
+// A u32 offset per block (relative to the start of the name data) lets a
+// reader decode the i-th name by scanning at most one block.
+//
+//   u32 names_size
+//   u32 block_offsets[ceil(file_count / kNameBlockSize)]
+//   u8  name_data[names_size]
+
+namespace minipack_format {
+
+inline constexpr std::uint32_t kNameBlockSize = 16;
+
+inline std::uint32_t name_block_count(std::uint32_t file_count)
+{
+    return (file_count + kNameBlockSize - 1) / kNameBlockSize;
+}
+
+inline void append_varint(std::vector<std::uint8_t> &buf, std::uint32_t v)
+{
+    while (v >= 0x80) {
+        buf.push_back(static_cast<std::uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    buf.push_back(static_cast<std::uint8_t>(v));
+}
+
+inline bool read_varint(const std::uint8_t *buf, std::size_t size, std::size_t &pos, std::uint32_t &out)
+{
+    std::uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (pos >= size) return false;
+        const std::uint8_t b = buf[pos++];
+        v |= static_cast<std::uint32_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Append the table for 'count' names, where name_at(i) returns a string_view.
+template<typename NameAt>
+void append_front_coded_names(std::vector<std::uint8_t> &info, std::uint32_t count, NameAt name_at)
+{
+    std::vector<std::uint8_t> data;
+    std::vector<std::uint32_t> block_offsets;
+    block_offsets.reserve(name_block_count(count));
+
+    std::string_view prev;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const std::string_view name = name_at(i);
+        if (i % kNameBlockSize == 0) {
+            block_offsets.push_back(static_cast<std::uint32_t>(data.size()));
+            append_varint(data, static_cast<std::uint32_t>(name.size()));
+            data.insert(data.end(), name.begin(), name.end());
+        } else {
+            std::size_t shared = 0;
+            const std::size_t limit = prev.size() < name.size() ? prev.size() : name.size();
+            while (shared < limit && prev[shared] == name[shared]) ++shared;
+            append_varint(data, static_cast<std::uint32_t>(shared));
+            append_varint(data, static_cast<std::uint32_t>(name.size() - shared));
+            data.insert(data.end(), name.begin() + shared, name.end());
+        }
+        prev = name;
+    }
+
+    append_u32_le(info, static_cast<std::uint32_t>(data.size()));
+    for (std::uint32_t off : block_offsets) append_u32_le(info, off);
+    info.insert(info.end(), data.begin(), data.end());
+}
+
+// Read-only view over a front-coded table inside an info block.
+class FrontCodedNames {
+public:
+    // Parse the table header at info[pos]; on success pos is moved past the table.
+    bool open(const std::uint8_t *info, std::size_t info_size, std::size_t &pos, std::uint32_t count)
+    {
+        std::uint32_t names_size = 0;
+        if (!read_u32_le(info, info_size, pos, names_size)) return false;
+        if (names_size < count) return false; // every record takes at least one byte
+        const std::uint32_t blocks = name_block_count(count);
+        if (pos + kU32Size * static_cast<std::size_t>(blocks) > info_size) return false;
+        m_offsets = info + pos;
+        pos += kU32Size * static_cast<std::size_t>(blocks);
+        if (pos + names_size > info_size) return false;
+        m_data = info + pos;
+        m_size = names_size;
+        m_count = count;
+        pos += names_size;
+        return true;
+    }
+
+    std::uint32_t count() const { return m_count; }
+    std::uint32_t block_count() const { return name_block_count(m_count); }
+
+    // Decode name 'i' into 'out' (scans at most one block).
+    bool name_at(std::uint32_t i, std::string &out) const
+    {
+        if (i >= m_count) return false;
+        const std::uint32_t block = i / kNameBlockSize;
+        std::size_t pos = block_offset(block);
+        out.clear();
+        for (std::uint32_t j = block * kNameBlockSize; j <= i; ++j) {
+            if (!next(pos, j % kNameBlockSize == 0, out)) return false;
+        }
+        return true;
+    }
+
+    // Decode every name in order, calling fn(index, const std::string&).
+    template<typename Fn>
+    bool for_each(Fn fn) const
+    {
+        return for_each_in_blocks(0, block_count(), fn);
+    }
+
+    // Same for the names of blocks [first_block, end_block). Consecutive ranges
+    // check the same block boundaries as one full pass, so they can be decoded
+    // independently (e.g. on several threads).
+    template<typename Fn>
+    bool for_each_in_blocks(std::uint32_t first_block, std::uint32_t end_block, Fn fn) const
+    {
+        std::string name;
+        std::size_t pos = first_block == 0 ? 0 : block_offset(first_block);
+        const std::uint64_t end = std::min<std::uint64_t>(m_count, std::uint64_t{end_block} * kNameBlockSize);
+        for (std::uint32_t i = first_block * kNameBlockSize; i < end; ++i) {
+            const bool first = i % kNameBlockSize == 0;
+            if (first && block_offset(i / kNameBlockSize) != pos) return false;
+            if (!next(pos, first, name)) return false;
+            fn(i, name);
+        }
+        return pos == (end_block >= block_count() ? m_size : block_offset(end_block));
+    }
+
+private:
+    std::size_t block_offset(std::uint32_t block) const { return read_u32_le_4(m_offsets + kU32Size * block); }
+
+    // Decode one record at pos; 'name' holds the previous name within the block.
+    bool next(std::size_t &pos, bool first, std::string &name) const
+    {
+        std::uint32_t shared = 0, len = 0;
+        if (!first && !read_varint(m_data, m_size, pos, shared)) return false;
+        if (!read_varint(m_data, m_size, pos, len)) return false;
+        if (shared > name.size() || len > m_size - pos) return false;
+        name.resize(shared);
+        name.append(reinterpret_cast<const char*>(m_data + pos), len);
+        pos += len;
+        return true;
+    }
+
+    const std::uint8_t *m_offsets = nullptr;
+    const std::uint8_t *m_data = nullptr;
+    std::size_t m_size = 0;
+    std::uint32_t m_count = 0;
+};
+
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fork/join helpers: chunked loops for the index loader on very large packs, and
+// the work-claiming pool the builder writes runs and volumes with.
+
+namespace minipack_parallel {
+
+// Indexes with at least this many entries are parsed and sorted on several threads
+inline constexpr std::size_t kParallelIndexEntries = 64 * 1024;
+// Smallest slice of entries worth handing to a thread
+inline constexpr std::size_t kMinChunkEntries = 16 * 1024;
+
+// Slices to split 'count' entries into: 1 below the threshold, else up to one per hardware thread
+inline std::size_t chunk_count(std::size_t count)
+{
+    if (count < kParallelIndexEntries) return 1;
+    const std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    return std::max<std::size_t>(1, std::min(threads, count / kMinChunkEntries));
+}
+
+// Run fn(chunk, begin, end) over 'chunks' contiguous slices of [0, count);
+// slice 0 runs on the calling thread.
+template<typename Fn>
+void for_chunks(std::size_t count, std::size_t chunks, Fn fn)
+{
+    auto slice = [&](std::size_t c) { fn(c, count * c / chunks, count * (c + 1) / chunks); };
+    std::vector<std::thread> pool;
+    pool.reserve(chunks - 1);
+    for (std::size_t c = 1; c < chunks; ++c) pool.emplace_back(slice, c);
+    slice(0);
+    for (auto &t : pool) t.join();
+}
+
+// Workers used for 'items' items with up to 'threads' threads (0 = hardware concurrency)
+inline unsigned worker_count(std::size_t items, unsigned threads)
+{
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(items, 1)));
+}
+
+// Run task(worker, item, err) for every item in [0, items) on worker_count(items, threads)
+// workers that claim items in order; worker 0 is the calling thread. The first failure
+// stops the others and its message is returned in 'err'.
+template<typename Task>
+bool for_each_claimed(std::size_t items, unsigned threads, std::string &err, Task task)
+{
+    const unsigned workers = worker_count(items, threads);
+    std::atomic<std::size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::mutex err_mutex;
+    auto worker = [&](unsigned w) {
+        std::string local_err;
+        for (std::size_t i = next++; i < items && !failed; i = next++) {
+            if (task(w, i, local_err)) continue;
+            std::lock_guard<std::mutex> lock(err_mutex);
+            if (!failed.exchange(true)) err = local_err;
+            return;
+        }
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (unsigned w = 1; w < workers; ++w) pool.emplace_back(worker, w);
+    worker(0);
+    for (auto &t : pool) t.join();
+    return !failed;
+}
+
+}
@@ -0,0 +1,151 @@
+﻿#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "mini_pack_builder.h"
+#include "minipack_delta.h"
+#include "minipack_hash.h"
+#include "pack_reader_memory.h"
+
+// Rebuild a new pack from an old pack and a delta written by minipack_diff.
+// Copy ops are served straight from a mapping of the old pack, so unchanged
+// ranges go out as large writes; the result is checked against the size and
+// hash recorded in the delta.
+
+namespace {
+
+// Parse the delta header and check that it was made against 'old_bytes'
+bool check_delta_header(std::span<const std::uint8_t> delta, std::span<const std::uint8_t> old_bytes, minipack_delta::Header &header, std::string &err)
+{
+    if (delta.size() < minipack_delta::kHeaderSize || std::memcmp(delta.data(), minipack_delta::kMagic, sizeof(minipack_delta::kMagic)) != 0) {
+        err = "Not a MiniPack delta file";
+        return false;
+    }
+    const std::uint8_t *h = delta.data() + sizeof(minipack_delta::kMagic);
+    header.old_size = minipack_delta::read_u64_le_8(h);
+    header.old_header_size = minipack_delta::read_u64_le_8(h + 8);
+    header.old_header_hash = minipack_delta::read_u64_le_8(h + 16);
+    header.new_size = minipack_delta::read_u64_le_8(h + 24);
+    header.new_hash = minipack_delta::read_u64_le_8(h + 32);
+
+    if (old_bytes.size() != header.old_size || header.old_header_size > old_bytes.size()
+        || minipack_hash::fnv1a64(old_bytes.data(), static_cast<std::size_t>(header.old_header_size)) != header.old_header_hash) {
+        err = "Old pack does not match the delta";
+        return false;
+    }
+    return true;
+}
+
+bool apply_delta(std::span<const std::uint8_t> delta, const minipack_delta::Header &header, std::span<const std::uint8_t> old_bytes, MiniPackWriter *writer, std::string &err)
+{
+    if (!writer->reserve(header.new_size, err)) return false;
+
+    minipack_hash::Fnv1a64 hash;
+    std::uint64_t written = 0;
+    std::size_t pos = minipack_delta::kHeaderSize;
+    auto read_u64 = [&](std::uint64_t &v) {
+        if (delta.size() - pos < 8) return false;
+        v = minipack_delta::read_u64_le_8(delta.data() + pos);
+        pos += 8;
+        return true;
+    };
+
+    for (;;) {
+        if (pos >= delta.size()) { err = "Delta truncated (missing end marker)"; return false; }
+        const std::uint8_t op = delta[pos++];
+        if (op == minipack_delta::kOpEnd) break;
+
+        const std::uint8_t *src = nullptr;
+        std::uint64_t length = 0;
+        if (op == minipack_delta::kOpCopy) {
+            std::uint64_t offset = 0;
+            if (!read_u64(offset) || !read_u64(length)) { err = "Delta truncated (copy)"; return false; }
+            if (offset > old_bytes.size() || old_bytes.size() - offset < length) { err = "Delta copy outside the old pack"; return false; }
+            src = old_bytes.data() + offset;
+        } else if (op == minipack_delta::kOpData) {
+            if (!read_u64(length) || delta.size() - pos < length) { err = "Delta truncated (data)"; return false; }
+            src = delta.data() + pos;
+            pos += static_cast<std::size_t>(length);
+        } else {
+            err = "Delta corrupted (unknown op)";
+            return false;
+        }
+        if (header.new_size - written < length) { err = "Delta produces more bytes than recorded"; return false; }
+        if (!writer->write(src, static_cast<std::size_t>(length), err)) return false;
+        hash.update(src, static_cast<std::size_t>(length));
+        written += length;
+    }
+
+    if (!writer->flush(err)) return false;
+    if (written != header.new_size || hash.value != header.new_hash) {
+        err = "Patched pack does not match the recorded size/hash";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 4) {
+        std::cout << "Usage: " << argv[0] << " <old.pack> <in.delta> <new.pack>\n";
+        return 1;
+    }
+    const std::string old_path = argv[1];
+    const std::string delta_path = argv[2];
+    const std::string out_path = argv[3];
+    std::string err;
+
+    // The inputs stay mapped while the output is written, so it must be a different file
+    std::error_code ec;
+    if (std::filesystem::equivalent(out_path, old_path, ec) || std::filesystem::equivalent(out_path, delta_path, ec)) {
+        std::cerr << "Error: output must not be one of the inputs: " << out_path << "\n";
+        return 1;
+    }
+
+    MiniPackMappedFile old_map, delta_map;
+    MiniPackMemoryReader old_pack;
+    minipack_delta::Header header;
+    if (!old_map.open(old_path, err) || !delta_map.open(delta_path, err) || !old_pack.open(old_map.bytes(), err)) {
+        std::cerr << "Error: " << err << "\n";
+        return 1;
+    }
+    // Deltas cover single-file packs only; copies could not reach data in volume files
+    if (old_pack.index().volume_count() > 0) {
+        std::cerr << "Error: multi-volume packs are not supported: " << old_path << "\n";
+        return 1;
+    }
+    if (!check_delta_header(delta_map.bytes(), old_map.bytes(), header, err)) {
+        std::cerr << "Error: " << err << "\n";
+        return 1;
+    }
+
+    // Write beside the destination and replace it only once the result is verified
+    const std::string tmp_path = out_path + ".tmp";
+    bool ok = false;
+    {
+        auto writer = create_file_writer(tmp_path);
+        if (!writer) {
+            std::cerr << "Failed to open output file: " << tmp_path << "\n";
+            return 1;
+        }
+        ok = apply_delta(delta_map.bytes(), header, old_map.bytes(), writer.get(), err);
+    }
+    if (ok) {
+        std::filesystem::rename(tmp_path, out_path, ec);
+        if (ec) {
+            err = "Failed to replace " + out_path + ": " + ec.message();
+            ok = false;
+        }
+    }
+    if (!ok) {
+        std::filesystem::remove(tmp_path, ec);
+        std::cerr << "Error: " << err << "\n";
+        return 1;
+    }
+    std::cout << "Patched " << out_path << "\n";
+    return 0;
+}
@@ -0,0 +1,322 @@
+﻿#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "minipack_args.h"
+
+// End-to-end performance regression runner (POSIX only).
+// Generates a synthetic input tree in a temporary directory, runs the MiniPack
+// or minipack_info (--stats, reading every entry back) executable against it as
+// a child process and records wall time, peak RSS and read/write syscall counts. The metrics are compared to a
+// per-scenario JSON baseline; the run fails when any metric regresses by more
+// than the configured threshold. A missing baseline is recorded and passes.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct PerfConfig
+{
+    std::string scenario;      // pack | info
+    std::uint32_t files = 100000;
+    std::uint32_t max_file_size = 4096;
+    std::uint64_t seed = 1;
+    std::string pack_exe;
+    std::string info_exe;
+    std::string baseline_dir;
+    double threshold = 0.25;
+    bool update_baseline = false;
+    bool keep = false;
+};
+
+struct RunMetrics
+{
+    double wall_ms = 0.0;
+    double peak_rss_kb = 0.0;
+    double syscr = 0.0;
+    double syscw = 0.0;
+};
+
+struct MetricSpec
+{
+    const char *name;
+    double RunMetrics::*field;
+    double slack; // absolute allowance on top of the relative threshold
+};
+
+const MetricSpec kMetrics[] = {
+    {"wall_ms", &RunMetrics::wall_ms, 50.0},
+    {"peak_rss_kb", &RunMetrics::peak_rss_kb, 1024.0},
+    {"syscr", &RunMetrics::syscr, 16.0},
+    {"syscw", &RunMetrics::syscw, 16.0},
+};
+
+bool read_proc_io(pid_t pid, RunMetrics &m)
+{
+    std::ifstream in("/proc/" + std::to_string(pid) + "/io");
+    if (!in) return false;
+    std::string key;
+    std::uint64_t value = 0;
+    while (in >> key >> value) {
+        if (key == "syscr:") m.syscr = static_cast<double>(value);
+        else if (key == "syscw:") m.syscw = static_cast<double>(value);
+    }
+    return true;
+}
+
+// Run 'args' as a child process with stdout/stderr redirected to 'log_path'.
+bool run_child(const std::vector<std::string> &args, const std::string &log_path, RunMetrics &m, std::string &err)
+{
+    std::vector<char*> argv;
+    for (const auto &a : args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+
+    auto start = Clock::now();
+    pid_t pid = fork();
+    if (pid < 0) { err = std::string("fork failed: ") + std::strerror(errno); return false; }
+    if (pid == 0) {
+        int fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    // Wait without reaping so /proc/<pid>/io is still readable, then reap for rusage
+    siginfo_t info{};
+    if (waitid(P_PID, static_cast<id_t>(pid), &info, WEXITED | WNOWAIT) != 0) { err = "waitid failed"; return false; }
+    m.wall_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    read_proc_io(pid, m);
+
+    int status = 0;
+    struct rusage ru{};
+    if (wait4(pid, &status, 0, &ru) < 0) { err = "wait4 failed"; return false; }
+    m.peak_rss_kb = static_cast<double>(ru.ru_maxrss);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        err = "Command failed: " + args[0] + " (see " + log_path + ")";
+        return false;
+    }
+    return true;
+}
+
+// "<prefix><n><suffix>" built by appending (a chain of std::string operator+
+// here trips a GCC 12 -Wrestrict false positive in Release builds)
+std::string numbered_name(const char *prefix, std::uint32_t n, const char *suffix = "")
+{
+    const std::string digits = std::to_string(n);
+    std::string name;
+    name.reserve(std::strlen(prefix) + digits.size() + std::strlen(suffix));
+    name.append(prefix).append(digits).append(suffix);
+    return name;
+}
+
+// Directory d of the generated tree: d<d % 32>/s<d>
+std::filesystem::path tree_dir(const std::filesystem::path &root, std::uint32_t d)
+{
+    return root / numbered_name("d", d % 32) / numbered_name("s", d);
+}
+
+bool generate_tree(const std::filesystem::path &root, const PerfConfig &cfg, std::string &err)
+{
+    std::mt19937_64 rng(cfg.seed);
+    std::uniform_int_distribution<std::uint32_t> size_dist(0, cfg.max_file_size);
+    std::vector<char> buf(cfg.max_file_size);
+    for (auto &c : buf) c = static_cast<char>(rng());
+
+    const std::uint32_t dirs = cfg.files / 1000 + 1;
+    std::error_code ec;
+    for (std::uint32_t d = 0; d < dirs; ++d) {
+        std::filesystem::create_directories(tree_dir(root, d), ec);
+        if (ec) { err = "Failed to create directory under " + root.string(); return false; }
+    }
+    for (std::uint32_t i = 0; i < cfg.files; ++i) {
+        const std::uint32_t d = i % dirs;
+        const std::filesystem::path p = tree_dir(root, d) / numbered_name("f", i, ".dat");
+        std::ofstream out(p, std::ios::binary);
+        const std::uint32_t sz = size_dist(rng);
+        if (!out || !out.write(buf.data(), sz)) { err = "Failed to write " + p.string(); return false; }
+    }
+    return true;
+}
+
+std::string baseline_path(const PerfConfig &cfg, const char *suffix)
+{
+    return (std::filesystem::path(cfg.baseline_dir) / (cfg.scenario + "_" + std::to_string(cfg.files) + suffix)).string();
+}
+
+bool write_metrics_json(const std::string &path, const PerfConfig &cfg, const RunMetrics &m)
+{
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "{\n  \"scenario\": \"" << cfg.scenario << "\",\n  \"files\": " << cfg.files << ",\n  \"metrics\": {\n";
+    for (std::size_t i = 0; i < std::size(kMetrics); ++i) {
+        out << "    \"" << kMetrics[i].name << "\": " << std::fixed << std::setprecision(3) << m.*kMetrics[i].field;
+        out << (i + 1 < std::size(kMetrics) ? ",\n" : "\n");
+    }
+    out << "  }\n}\n";
+    return static_cast<bool>(out);
+}
+
+// Minimal reader for the flat JSON written by write_metrics_json.
+bool read_metrics_json(const std::string &path, RunMetrics &m)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string text = ss.str();
+    std::size_t metrics_pos = text.find("\"metrics\"");
+    if (metrics_pos == std::string::npos) return false;
+    for (const auto &spec : kMetrics) {
+        std::size_t p = text.find(std::string("\"") + spec.name + "\"", metrics_pos);
+        if (p == std::string::npos) return false;
+        p = text.find(':', p);
+        if (p == std::string::npos) return false;
+        m.*spec.field = std::strtod(text.c_str() + p + 1, nullptr);
+    }
+    return true;
+}
+
+bool parse_u32(const char *s, std::uint32_t &out)
+{
+    std::uint64_t v = 0;
+    if (!minipack_args::parse_u64(s, v) || v > 0xFFFFFFFFull) return false;
+    out = static_cast<std::uint32_t>(v);
+    return true;
+}
+
+// Non-negative finite number; the whole argument must be consumed
+bool parse_ratio(const char *s, double &out)
+{
+    char *end = nullptr;
+    errno = 0;
+    const double v = std::strtod(s, &end);
+    if (end == s || *end != '\0' || errno != 0 || !std::isfinite(v) || v < 0.0) return false;
+    out = v;
+    return true;
+}
+
+bool parse_args(int argc, char **argv, PerfConfig &cfg)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char *v = nullptr;
+        if (a == "--scenario" && (v = next())) cfg.scenario = v;
+        else if (a == "--files" && (v = next())) { if (!parse_u32(v, cfg.files)) return false; }
+        else if (a == "--max-file-size" && (v = next())) { if (!parse_u32(v, cfg.max_file_size)) return false; }
+        else if (a == "--seed" && (v = next())) { if (!minipack_args::parse_u64(v, cfg.seed)) return false; }
+        else if (a == "--pack-exe" && (v = next())) cfg.pack_exe = v;
+        else if (a == "--info-exe" && (v = next())) cfg.info_exe = v;
+        else if (a == "--baseline-dir" && (v = next())) cfg.baseline_dir = v;
+        else if (a == "--threshold" && (v = next())) { if (!parse_ratio(v, cfg.threshold)) return false; }
+        else if (a == "--update-baseline") cfg.update_baseline = true;
+        else if (a == "--keep") cfg.keep = true;
+        else return false;
+    }
+    if (cfg.scenario != "pack" && cfg.scenario != "info") return false;
+    if (cfg.pack_exe.empty() || cfg.baseline_dir.empty() || cfg.files == 0) return false;
+    if (cfg.scenario == "info" && cfg.info_exe.empty()) return false;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    PerfConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        std::cout << "Usage: " << argv[0] << " --scenario pack|info --pack-exe <MiniPack> [--info-exe <minipack_info>]\n"
+                  << "       --baseline-dir <dir> [--files N] [--max-file-size N] [--seed N]\n"
+                  << "       [--threshold 0.25] [--update-baseline] [--keep]\n";
+        return 1;
+    }
+
+    std::error_code ec;
+    std::string tmpl = (std::filesystem::temp_directory_path(ec) / "minipack_perf_XXXXXX").string();
+    if (!mkdtemp(tmpl.data())) {
+        std::cerr << "Failed to create temporary directory\n";
+        return 1;
+    }
+    const std::filesystem::path work(tmpl);
+    const std::filesystem::path tree = work / "tree";
+    const std::string pack_path = (work / "out.pack").string();
+    const std::string log_path = (work / "child.log").string();
+
+    std::string err;
+    int rc = 0;
+    RunMetrics current;
+    do {
+        if (!generate_tree(tree, cfg, err)) { rc = 1; break; }
+
+        RunMetrics pack_metrics;
+        if (!run_child({cfg.pack_exe, tree.string(), pack_path}, log_path, pack_metrics, err)) { rc = 1; break; }
+        // The info scenario reads the pack back: --stats looks up and reads every entry once
+        if (cfg.scenario == "pack") {
+            current = pack_metrics;
+        } else if (!run_child({cfg.info_exe, pack_path, "--stats"}, log_path, current, err)) {
+            rc = 1;
+            break;
+        }
+    } while (false);
+
+    if (!cfg.keep) std::filesystem::remove_all(work, ec);
+    if (rc != 0) {
+        std::cerr << "Error: " << err << "\n";
+        return rc;
+    }
+
+    std::filesystem::create_directories(cfg.baseline_dir, ec);
+    write_metrics_json(baseline_path(cfg, ".last.json"), cfg, current);
+
+    const std::string base_file = baseline_path(cfg, ".json");
+    RunMetrics baseline;
+    if (cfg.update_baseline || !read_metrics_json(base_file, baseline)) {
+        if (!write_metrics_json(base_file, cfg, current)) {
+            std::cerr << "Error: failed to write baseline " << base_file << "\n";
+            return 1;
+        }
+        std::cout << "Recorded baseline " << base_file << "\n";
+        baseline = current;
+    }
+
+    bool regressed = false;
+    std::cout << std::left << std::setw(14) << "metric" << std::right << std::setw(14) << "baseline" << std::setw(14) << "current" << std::setw(10) << "ratio" << "\n";
+    for (const auto &spec : kMetrics) {
+        const double b = baseline.*spec.field;
+        const double c = current.*spec.field;
+        const double limit = b * (1.0 + cfg.threshold) + spec.slack;
+        const bool bad = c > limit;
+        regressed = regressed || bad;
+        std::cout << std::left << std::setw(14) << spec.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << b << std::setw(14) << c << std::setw(10) << std::setprecision(3) << (b > 0.0 ? c / b : 0.0)
+                  << (bad ? "  REGRESSION" : "") << "\n";
+    }
+
+    if (regressed) {
+        std::cerr << "Performance regression above threshold " << cfg.threshold << " in scenario " << cfg.scenario << "\n";
+        return 1;
+    }
+    return 0;
+}
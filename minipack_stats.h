@@ -0,0 +1,308 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <ios>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Optional I/O metrics for one pack: counters and latency histograms filled in by
+// the reader functions (pack_reader_io.h, MiniPackMemoryReader, MiniPackIndex::find)
+// and MiniPackBuilder::build_pack when a MiniPackStats is passed to them.
+// Recording is lock-free except for per-entry hit counts, which are opt-in.
+// Building with MINIPACK_ENABLE_STATS=0 (CMake option MINIPACK_STATS=OFF) turns
+// every record call into a no-op and skips the clock reads.
+
+#ifndef MINIPACK_ENABLE_STATS
+#define MINIPACK_ENABLE_STATS 1
+#endif
+
+// Latency distribution; bucket i counts samples in [2^i, 2^(i+1)) nanoseconds.
+struct MiniPackLatencySnapshot
+{
+    static constexpr std::size_t kBuckets = 40;
+
+    std::uint64_t count = 0;
+    std::uint64_t total_ns = 0;
+    std::uint64_t max_ns = 0;
+    std::array<std::uint64_t, kBuckets> buckets{};
+
+    double mean_ns() const { return count ? static_cast<double>(total_ns) / static_cast<double>(count) : 0.0; }
+
+    // Upper bound of the bucket holding the p-th percentile (p in [0, 1])
+    std::uint64_t percentile_ns(double p) const
+    {
+        if (count == 0) return 0;
+        const std::uint64_t rank = static_cast<std::uint64_t>(p * static_cast<double>(count - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            seen += buckets[i];
+            if (seen >= rank) return std::min(max_ns, (std::uint64_t{2} << i) - 1);
+        }
+        return max_ns;
+    }
+};
+
+class MiniPackLatencyHistogram
+{
+public:
+    void record(std::uint64_t ns)
+    {
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_total_ns.fetch_add(ns, std::memory_order_relaxed);
+        std::uint64_t prev = m_max_ns.load(std::memory_order_relaxed);
+        while (ns > prev && !m_max_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {}
+        std::size_t bucket = 0;
+        for (std::uint64_t v = ns >> 1; v != 0 && bucket + 1 < MiniPackLatencySnapshot::kBuckets; v >>= 1) ++bucket;
+        m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    MiniPackLatencySnapshot snapshot() const
+    {
+        MiniPackLatencySnapshot s;
+        s.count = m_count.load(std::memory_order_relaxed);
+        s.total_ns = m_total_ns.load(std::memory_order_relaxed);
+        s.max_ns = m_max_ns.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < MiniPackLatencySnapshot::kBuckets; ++i) s.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        return s;
+    }
+
+    void reset()
+    {
+        m_count.store(0, std::memory_order_relaxed);
+        m_total_ns.store(0, std::memory_order_relaxed);
+        m_max_ns.store(0, std::memory_order_relaxed);
+        for (auto &b : m_buckets) b.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::uint64_t> m_count{0};
+    std::atomic<std::uint64_t> m_total_ns{0};
+    std::atomic<std::uint64_t> m_max_ns{0};
+    std::array<std::atomic<std::uint64_t>, MiniPackLatencySnapshot::kBuckets> m_buckets{};
+};
+
+struct MiniPackStatsSnapshot
+{
+    std::uint64_t index_loads = 0;
+    std::uint64_t index_load_errors = 0;
+    std::uint64_t index_bytes = 0;          // info block bytes parsed
+    std::uint64_t lookups = 0;              // MiniPackIndex::find calls
+    std::uint64_t lookup_misses = 0;
+    std::uint64_t reads = 0;                // entry reads (copies and zero-copy views)
+    std::uint64_t read_errors = 0;
+    std::uint64_t read_bytes = 0;
+    std::uint64_t builds = 0;               // MiniPackBuilder::build_pack calls
+    std::uint64_t build_errors = 0;
+    std::uint64_t build_bytes = 0;
+
+    MiniPackLatencySnapshot index_load_latency;
+    MiniPackLatencySnapshot read_latency;   // copying reads only; views are not timed
+    MiniPackLatencySnapshot build_latency;
+
+    // Per-entry read counts, most read first; empty unless tracking was enabled
+    std::vector<std::pair<std::string, std::uint64_t>> entry_hits;
+};
+
+class MiniPackStats
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit MiniPackStats(bool track_entry_hits = false) : m_track_entry_hits(track_entry_hits) {}
+
+    MiniPackStats(const MiniPackStats &) = delete;
+    MiniPackStats &operator=(const MiniPackStats &) = delete;
+
+    // Start time for a timed operation; a default time point when stats are compiled out
+    static Clock::time_point start()
+    {
+#if MINIPACK_ENABLE_STATS
+        return Clock::now();
+#else
+        return {};
+#endif
+    }
+
+    void record_index_load(Clock::time_point start, std::uint64_t info_bytes, bool ok)
+    {
+#if MINIPACK_ENABLE_STATS
+        add(m_index_loads, 1);
+        if (!ok) { add(m_index_load_errors, 1); return; }
+        add(m_index_bytes, info_bytes);
+        m_index_load_latency.record(elapsed_ns(start));
+#else
+        (void)start; (void)info_bytes; (void)ok;
+#endif
+    }
+
+    void record_lookup(bool hit)
+    {
+#if MINIPACK_ENABLE_STATS
+        add(m_lookups, 1);
+        if (!hit) add(m_lookup_misses, 1);
+#else
+        (void)hit;
+#endif
+    }
+
+    // Untimed read, e.g. a zero-copy view
+    void record_read(std::string_view entry_name, std::uint64_t bytes, bool ok)
+    {
+#if MINIPACK_ENABLE_STATS
+        add(m_reads, 1);
+        if (!ok) { add(m_read_errors, 1); return; }
+        add(m_read_bytes, bytes);
+        if (m_track_entry_hits) hit_entry(entry_name);
+#else
+        (void)entry_name; (void)bytes; (void)ok;
+#endif
+    }
+
+    void record_read(std::string_view entry_name, Clock::time_point start, std::uint64_t bytes, bool ok)
+    {
+#if MINIPACK_ENABLE_STATS
+        record_read(entry_name, bytes, ok);
+        if (ok) m_read_latency.record(elapsed_ns(start));
+#else
+        (void)entry_name; (void)start; (void)bytes; (void)ok;
+#endif
+    }
+
+    void record_build(Clock::time_point start, std::uint64_t bytes, bool ok)
+    {
+#if MINIPACK_ENABLE_STATS
+        add(m_builds, 1);
+        if (!ok) { add(m_build_errors, 1); return; }
+        add(m_build_bytes, bytes);
+        m_build_latency.record(elapsed_ns(start));
+#else
+        (void)start; (void)bytes; (void)ok;
+#endif
+    }
+
+    // Consistent per counter; counters recorded concurrently may be a few samples apart.
+    MiniPackStatsSnapshot snapshot() const
+    {
+        MiniPackStatsSnapshot s;
+        s.index_loads = load(m_index_loads);
+        s.index_load_errors = load(m_index_load_errors);
+        s.index_bytes = load(m_index_bytes);
+        s.lookups = load(m_lookups);
+        s.lookup_misses = load(m_lookup_misses);
+        s.reads = load(m_reads);
+        s.read_errors = load(m_read_errors);
+        s.read_bytes = load(m_read_bytes);
+        s.builds = load(m_builds);
+        s.build_errors = load(m_build_errors);
+        s.build_bytes = load(m_build_bytes);
+        s.index_load_latency = m_index_load_latency.snapshot();
+        s.read_latency = m_read_latency.snapshot();
+        s.build_latency = m_build_latency.snapshot();
+        if (m_track_entry_hits) {
+            std::lock_guard<std::mutex> lock(m_hits_mutex);
+            s.entry_hits.assign(m_entry_hits.begin(), m_entry_hits.end());
+            std::sort(s.entry_hits.begin(), s.entry_hits.end(), [](const auto &a, const auto &b) {
+                return a.second != b.second ? a.second > b.second : a.first < b.first;
+            });
+        }
+        return s;
+    }
+
+    void reset()
+    {
+        for (auto *c : {&m_index_loads, &m_index_load_errors, &m_index_bytes, &m_lookups, &m_lookup_misses, &m_reads,
+                        &m_read_errors, &m_read_bytes, &m_builds, &m_build_errors, &m_build_bytes})
+            c->store(0, std::memory_order_relaxed);
+        m_index_load_latency.reset();
+        m_read_latency.reset();
+        m_build_latency.reset();
+        std::lock_guard<std::mutex> lock(m_hits_mutex);
+        m_entry_hits.clear();
+    }
+
+private:
+    using Counter = std::atomic<std::uint64_t>;
+
+    struct NameHash
+    {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    };
+
+    static void add(Counter &c, std::uint64_t v) { c.fetch_add(v, std::memory_order_relaxed); }
+    static std::uint64_t load(const Counter &c) { return c.load(std::memory_order_relaxed); }
+
+    static std::uint64_t elapsed_ns(Clock::time_point start)
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+    void hit_entry(std::string_view name)
+    {
+        std::lock_guard<std::mutex> lock(m_hits_mutex);
+        auto it = m_entry_hits.find(name);
+        if (it == m_entry_hits.end()) m_entry_hits.emplace(std::string(name), 1);
+        else ++it->second;
+    }
+
+    Counter m_index_loads{0};
+    Counter m_index_load_errors{0};
+    Counter m_index_bytes{0};
+    Counter m_lookups{0};
+    Counter m_lookup_misses{0};
+    Counter m_reads{0};
+    Counter m_read_errors{0};
+    Counter m_read_bytes{0};
+    Counter m_builds{0};
+    Counter m_build_errors{0};
+    Counter m_build_bytes{0};
+    MiniPackLatencyHistogram m_index_load_latency;
+    MiniPackLatencyHistogram m_read_latency;
+    MiniPackLatencyHistogram m_build_latency;
+
+    bool m_track_entry_hits;
+    mutable std::mutex m_hits_mutex;
+    std::unordered_map<std::string, std::uint64_t, NameHash, std::equal_to<>> m_entry_hits;
+};
+
+// Human-readable dump of a snapshot; at most 'top_entries' entry hit counts are listed.
+inline void print_minipack_stats(std::ostream &os, const MiniPackStatsSnapshot &s, std::size_t top_entries = 10)
+{
+    const std::ios::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+    auto latency = [&](const char *name, const MiniPackLatencySnapshot &l) {
+        if (l.count == 0) return;
+        os << std::left << std::setw(14) << name << std::right
+           << " n=" << l.count
+           << " mean=" << std::fixed << std::setprecision(1) << l.mean_ns() / 1000.0 << "us"
+           << " p50<=" << l.percentile_ns(0.50) / 1000.0 << "us"
+           << " p99<=" << l.percentile_ns(0.99) / 1000.0 << "us"
+           << " max=" << l.max_ns / 1000.0 << "us\n";
+    };
+    os << "Index loads : " << s.index_loads << " (" << s.index_load_errors << " failed, " << s.index_bytes << " info bytes)\n";
+    os << "Lookups     : " << s.lookups << " (" << s.lookup_misses << " misses)\n";
+    os << "Reads       : " << s.reads << " (" << s.read_errors << " failed, " << s.read_bytes << " bytes)\n";
+    if (s.builds) os << "Builds      : " << s.builds << " (" << s.build_errors << " failed, " << s.build_bytes << " bytes)\n";
+    latency("index load", s.index_load_latency);
+    latency("read", s.read_latency);
+    latency("build", s.build_latency);
+    if (!s.entry_hits.empty()) {
+        os << "Most read entries:\n";
+        for (std::size_t i = 0; i < s.entry_hits.size() && i < top_entries; ++i)
+            os << "  " << std::setw(8) << s.entry_hits[i].second << "  " << s.entry_hits[i].first << "\n";
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
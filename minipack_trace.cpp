@@ -0,0 +1,109 @@
+﻿#include "minipack_trace.h"
+#include "minipack_json.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <set>
+
+namespace {
+
+std::atomic<MiniPackTrace*> g_trace{nullptr};
+std::atomic<std::uint32_t> g_next_tid{1};
+std::atomic<std::uint32_t> g_main_tid{0};
+
+// Microseconds with nanosecond precision, as trace viewers expect for ts/dur
+void append_us(std::string &out, std::uint64_t ns)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%llu.%03u", static_cast<unsigned long long>(ns / 1000), static_cast<unsigned>(ns % 1000));
+    out += buf;
+}
+
+} // namespace
+
+MiniPackTrace::MiniPackTrace() : m_origin(Clock::now()) {}
+
+void MiniPackTrace::add_complete(const char *name, const char *category, Clock::time_point start, Clock::time_point end, std::string_view detail)
+{
+    Event e{name, category,
+            static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_origin).count()),
+            static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()),
+            minipack_trace_thread_id(), std::string(detail)};
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_events.push_back(std::move(e));
+}
+
+std::size_t MiniPackTrace::event_count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_events.size();
+}
+
+bool MiniPackTrace::write_json(const std::string &path, std::string &err) const
+{
+    std::string out;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        out.reserve(128 + m_events.size() * 128);
+        out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        // Name each track once so the viewer shows "main" / "worker N"
+        std::set<std::uint32_t> tids;
+        for (const Event &e : m_events) tids.insert(e.tid);
+        const std::uint32_t main_tid = g_main_tid.load(std::memory_order_relaxed);
+        bool first = true;
+        for (const std::uint32_t tid : tids) {
+            if (!first) out += ",\n";
+            first = false;
+            out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(tid) + ",\"args\":{\"name\":";
+            minipack_json::append_string(out, tid == main_tid ? std::string("main") : "worker " + std::to_string(tid));
+            out += "}}";
+        }
+
+        for (const Event &e : m_events) {
+            if (!first) out += ",\n";
+            first = false;
+            out += "{\"name\":";
+            minipack_json::append_string(out, e.name);
+            out += ",\"cat\":";
+            minipack_json::append_string(out, e.category);
+            out += ",\"ph\":\"X\",\"ts\":";
+            append_us(out, e.start_ns);
+            out += ",\"dur\":";
+            append_us(out, e.duration_ns);
+            out += ",\"pid\":1,\"tid\":" + std::to_string(e.tid);
+            if (!e.detail.empty()) {
+                out += ",\"args\":{\"detail\":";
+                minipack_json::append_string(out, e.detail);
+                out += "}";
+            }
+            out += "}";
+        }
+        out += "\n]}\n";
+    }
+
+    std::ofstream f(path, std::ios::binary);
+    if (!f) { err = "Failed to create trace file: " + path; return false; }
+    f.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!f) { err = "Failed to write trace file: " + path; return false; }
+    return true;
+}
+
+void minipack_set_trace(MiniPackTrace *trace)
+{
+    if (trace) g_main_tid.store(minipack_trace_thread_id(), std::memory_order_relaxed);
+    g_trace.store(trace, std::memory_order_release);
+}
+
+MiniPackTrace *minipack_active_trace()
+{
+    return g_trace.load(std::memory_order_acquire);
+}
+
+std::uint32_t minipack_trace_thread_id()
+{
+    thread_local const std::uint32_t id = g_next_tid.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
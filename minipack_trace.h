@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Phase-level tracing for pack builds, written as Chrome trace-event JSON
+// (open in chrome://tracing or Perfetto). A trace is installed process-wide with
+// minipack_set_trace; MiniPackTraceScope spans placed in the scanner, file list
+// reader, builder and file writer then record complete events on the calling
+// thread's track. With no trace installed a scope costs one atomic load.
+
+class MiniPackTrace
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    MiniPackTrace();
+
+    MiniPackTrace(const MiniPackTrace &) = delete;
+    MiniPackTrace &operator=(const MiniPackTrace &) = delete;
+
+    // 'name' and 'category' must be string literals; 'detail' is copied into the event args.
+    void add_complete(const char *name, const char *category, Clock::time_point start, Clock::time_point end, std::string_view detail = {});
+
+    std::size_t event_count() const;
+
+    bool write_json(const std::string &path, std::string &err) const;
+
+private:
+    struct Event
+    {
+        const char *name;
+        const char *category;
+        std::uint64_t start_ns;
+        std::uint64_t duration_ns;
+        std::uint32_t tid;
+        std::string detail;
+    };
+
+    Clock::time_point m_origin;
+    mutable std::mutex m_mutex;
+    std::vector<Event> m_events;
+};
+
+// Install 'trace' for all threads (nullptr stops tracing). Not owned; it must
+// outlive every span that can still record. The installing thread is named "main".
+void minipack_set_trace(MiniPackTrace *trace);
+MiniPackTrace *minipack_active_trace();
+
+// Small sequential id of the calling thread, used as its track in the trace.
+std::uint32_t minipack_trace_thread_id();
+
+// Records [construction, destruction) as one event when a trace is active.
+class MiniPackTraceScope
+{
+public:
+    explicit MiniPackTraceScope(const char *name, const char *category = "minipack", std::string_view detail = {})
+        : m_trace(minipack_active_trace()), m_name(name), m_category(category)
+    {
+        if (!m_trace) return;
+        m_detail.assign(detail);
+        m_start = MiniPackTrace::Clock::now();
+    }
+
+    ~MiniPackTraceScope()
+    {
+        if (m_trace) m_trace->add_complete(m_name, m_category, m_start, MiniPackTrace::Clock::now(), m_detail);
+    }
+
+    MiniPackTraceScope(const MiniPackTraceScope &) = delete;
+    MiniPackTraceScope &operator=(const MiniPackTraceScope &) = delete;
+
+private:
+    MiniPackTrace *m_trace;
+    const char *m_name;
+    const char *m_category;
+    std::string m_detail;
+    MiniPackTrace::Clock::time_point m_start;
+};
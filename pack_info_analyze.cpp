@@ -0,0 +1,433 @@
+﻿#include "pack_info_analyze.h"
+#include "minipack_hash.h"
+#include "minipack_json.h"
+#include "minipack_name_table.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+
+namespace {
+
+struct SizeBucket
+{
+    uint64_t limit;     // sizes below this
+    const char *label;
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+struct DuplicateGroup
+{
+    uint64_t size = 0;
+    std::vector<const MiniPackEntry*> entries;
+    uint64_t wasted() const { return size * (entries.size() - 1); }
+};
+
+struct ExtensionStats
+{
+    uint64_t entries = 0;
+    uint64_t bytes = 0;
+    uint64_t sampled = 0;
+    std::array<uint64_t, 256> histogram{};
+
+    // Order-0 entropy of the sampled bytes, in bits per byte
+    double entropy() const
+    {
+        if (sampled == 0) return 0.0;
+        double h = 0.0;
+        for (uint64_t n : histogram) {
+            if (n == 0) continue;
+            const double p = static_cast<double>(n) / static_cast<double>(sampled);
+            h -= p * std::log2(p);
+        }
+        return h;
+    }
+    double estimated_bytes() const { return static_cast<double>(bytes) * entropy() / 8.0; }
+};
+
+struct NameTableStats
+{
+    uint64_t info_size = 0;
+    uint64_t header_size = 0;
+    uint64_t name_bytes = 0;        // sum of name lengths
+    uint64_t plain_table = 0;       // u8 lengths + NUL-terminated names (format v1)
+    uint64_t front_coded_table = 0; // format v2 front-coded table for the same names
+    uint64_t index_tables = 0;      // offsets, sizes (and volumes)
+};
+
+struct AccessStats
+{
+    uint64_t accesses = 0;
+    uint64_t misses = 0;
+    uint64_t random_ios = 0;
+    uint64_t sequential = 0;
+    uint64_t bytes = 0;
+    uint64_t skipped_bytes = 0;     // gaps read through by sequential accesses
+};
+
+struct Report
+{
+    uint64_t entries = 0;
+    uint64_t data_bytes = 0;        // sum of entry sizes
+    uint64_t data_area = 0;         // bytes spanned by the data areas
+    uint64_t padding = 0;           // alignment gaps inside the data areas
+    uint64_t shared_entries = 0;    // entries already pointing at another entry's bytes
+    std::vector<SizeBucket> buckets;
+    std::vector<DuplicateGroup> duplicates;
+    uint64_t duplicate_entries = 0;
+    uint64_t duplicate_wasted = 0;
+    std::vector<std::pair<std::string, ExtensionStats>> extensions;   // by bytes, descending
+    NameTableStats names;
+    bool has_access = false;
+    AccessStats access;
+};
+
+std::string extension_of(std::string_view name)
+{
+    const size_t slash = name.find_last_of('/');
+    const std::string_view base = slash == std::string_view::npos ? name : name.substr(slash + 1);
+    const size_t dot = base.find_last_of('.');
+    if (dot == std::string_view::npos || dot == 0 || dot + 1 == base.size()) return "(none)";
+    std::string ext(base.substr(dot + 1));
+    for (char &c : ext)
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    return ext;
+}
+
+std::vector<SizeBucket> make_buckets()
+{
+    return {
+        {1, "0"}, {1ull << 10, "< 1 KiB"}, {4ull << 10, "< 4 KiB"}, {16ull << 10, "< 16 KiB"},
+        {64ull << 10, "< 64 KiB"}, {256ull << 10, "< 256 KiB"}, {1ull << 20, "< 1 MiB"},
+        {4ull << 20, "< 4 MiB"}, {16ull << 20, "< 16 MiB"}, {64ull << 20, "< 64 MiB"},
+        {UINT64_MAX, ">= 64 MiB"},
+    };
+}
+
+// Byte position of an entry inside its file, for layout questions
+uint64_t file_position(const MiniPackIndex &index, const MiniPackEntry &e)
+{
+    return (e.volume == 0 ? index.data_start() : 0) + e.offset;
+}
+
+bool find_duplicates(const MiniPackIndex &index, const PackRangeReader &read_range, Report &report, std::string &err)
+{
+    // Entries sharing a location are stored once already; only distinct locations count
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t>, const MiniPackEntry*> locations;
+    std::unordered_map<uint64_t, std::vector<const MiniPackEntry*>> by_size;
+    for (const MiniPackEntry &e : index.entries()) {
+        if (e.size == 0) continue;
+        if (!locations.emplace(std::make_tuple(e.volume, e.offset, e.size), &e).second) {
+            ++report.shared_entries;
+            continue;
+        }
+        by_size[e.size].push_back(&e);
+    }
+
+    // Only entries with a same-sized twin are hashed (and so read in full); a hash
+    // match is confirmed byte-wise against the group's first entry
+    std::vector<uint8_t> data, first;
+    for (auto &[size, candidates] : by_size) {
+        if (candidates.size() < 2) continue;
+        std::unordered_map<uint64_t, std::vector<DuplicateGroup>> groups;
+        for (const MiniPackEntry *e : candidates) {
+            if (!read_range(*e, 0, e->size, data, err)) {
+                err = e->name + ": " + err;
+                return false;
+            }
+            std::vector<DuplicateGroup> &same_hash = groups[minipack_hash::fnv1a64(data.data(), data.size())];
+            DuplicateGroup *match = nullptr;
+            for (DuplicateGroup &g : same_hash) {
+                const MiniPackEntry *f = g.entries.front();
+                if (!read_range(*f, 0, f->size, first, err)) {
+                    err = f->name + ": " + err;
+                    return false;
+                }
+                if (std::memcmp(first.data(), data.data(), data.size()) == 0) {
+                    match = &g;
+                    break;
+                }
+            }
+            if (!match) {
+                match = &same_hash.emplace_back();
+                match->size = size;
+            }
+            match->entries.push_back(e);
+        }
+        for (auto &[hash, same_hash] : groups) {
+            for (DuplicateGroup &g : same_hash) {
+                if (g.entries.size() < 2) continue;
+                report.duplicate_entries += g.entries.size() - 1;
+                report.duplicate_wasted += g.wasted();
+                report.duplicates.push_back(std::move(g));
+            }
+        }
+    }
+    std::sort(report.duplicates.begin(), report.duplicates.end(), [](const DuplicateGroup &a, const DuplicateGroup &b) {
+        return a.wasted() != b.wasted() ? a.wasted() > b.wasted() : a.entries.front()->name < b.entries.front()->name;
+    });
+
+    // Padding: what each data area spans beyond the distinct entries it holds
+    std::map<uint32_t, std::pair<uint64_t, uint64_t>> areas;   // volume -> (end, stored bytes)
+    for (const auto &[key, e] : locations) {
+        auto &area = areas[e->volume];
+        area.first = std::max<uint64_t>(area.first, uint64_t{e->offset} + e->size);
+        area.second += e->size;
+    }
+    for (const auto &[volume, area] : areas) {
+        report.data_area += area.first;
+        report.padding += area.first > area.second ? area.first - area.second : 0;
+    }
+    return true;
+}
+
+bool sample_extensions(const PackAnalyzeOptions &options, const MiniPackIndex &index, const PackRangeReader &read_range, Report &report, std::string &err)
+{
+    // Small entries are read whole; larger ones through three windows (start,
+    // middle, end) so headers alone do not decide the estimate
+    std::map<std::string, ExtensionStats> by_ext;
+    std::vector<uint8_t> data;
+    for (const MiniPackEntry &e : index.entries()) {
+        ExtensionStats &s = by_ext[extension_of(e.name)];
+        ++s.entries;
+        s.bytes += e.size;
+        if (e.size == 0 || options.sample_bytes == 0) continue;
+
+        std::vector<std::pair<uint64_t, uint64_t>> windows;
+        if (e.size <= options.sample_bytes) {
+            windows.emplace_back(0, e.size);
+        } else {
+            const uint64_t w = std::max<uint64_t>(options.sample_bytes / 3, 1);
+            windows = {{0, w}, {(e.size - w) / 2, w}, {e.size - w, w}};
+        }
+        for (const auto &[offset, length] : windows) {
+            if (!read_range(e, offset, length, data, err)) {
+                err = e.name + ": " + err;
+                return false;
+            }
+            for (uint8_t b : data) ++s.histogram[b];
+            s.sampled += data.size();
+        }
+    }
+    report.extensions.assign(by_ext.begin(), by_ext.end());
+    std::sort(report.extensions.begin(), report.extensions.end(), [](const auto &a, const auto &b) {
+        return a.second.bytes != b.second.bytes ? a.second.bytes > b.second.bytes : a.first < b.first;
+    });
+    return true;
+}
+
+void measure_names(const MiniPackIndex &index, Report &report)
+{
+    NameTableStats &n = report.names;
+    n.info_size = index.info_size();
+    n.header_size = index.data_start() - index.info_size();
+    std::vector<std::string_view> names;
+    names.reserve(index.entries().size());
+    for (const MiniPackEntry &e : index.entries()) {
+        names.push_back(e.name);
+        n.name_bytes += e.name.size();
+    }
+    n.plain_table = 2 * names.size() + n.name_bytes;
+    std::sort(names.begin(), names.end());
+    std::vector<uint8_t> table;
+    minipack_format::append_front_coded_names(table, static_cast<uint32_t>(names.size()), [&](uint32_t i) { return names[i]; });
+    n.front_coded_table = table.size();
+    n.index_tables = 8 * names.size() + (index.volume_count() > 0 ? 4 + 4 * names.size() : 0);
+}
+
+bool replay_access_log(const PackAnalyzeOptions &options, const MiniPackIndex &index, Report &report, std::string &err)
+{
+    std::ifstream in(options.access_log, std::ios::binary);
+    if (!in) { err = "Failed to open access log: " + options.access_log; return false; }
+    report.has_access = true;
+    AccessStats &a = report.access;
+    bool have_prev = false;
+    uint32_t prev_volume = 0;
+    uint64_t prev_end = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        ++a.accesses;
+        const MiniPackEntry *e = index.find(line);
+        if (!e) { ++a.misses; continue; }
+        if (e->size == 0) continue;
+        const uint64_t pos = file_position(index, *e);
+        // Sequential if it starts at or shortly after where the previous read ended
+        if (have_prev && e->volume == prev_volume && pos >= prev_end && pos - prev_end <= options.readahead) {
+            ++a.sequential;
+            a.skipped_bytes += pos - prev_end;
+        } else {
+            ++a.random_ios;
+        }
+        a.bytes += e->size;
+        have_prev = true;
+        prev_volume = e->volume;
+        prev_end = pos + e->size;
+    }
+    return true;
+}
+
+std::string json_number(double v)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.4f", v);
+    return buf;
+}
+
+void print_json(const Report &r, std::ostream &os)
+{
+    constexpr size_t kMaxGroups = 100;
+    std::string out = "{\n";
+    out += "  \"entries\": " + std::to_string(r.entries) + ",\n";
+    out += "  \"data_bytes\": " + std::to_string(r.data_bytes) + ",\n";
+    out += "  \"data_area_bytes\": " + std::to_string(r.data_area) + ",\n";
+    out += "  \"padding_bytes\": " + std::to_string(r.padding) + ",\n";
+    out += "  \"shared_entries\": " + std::to_string(r.shared_entries) + ",\n";
+
+    out += "  \"size_histogram\": [";
+    for (size_t i = 0; i < r.buckets.size(); ++i) {
+        out += i ? ",\n    " : "\n    ";
+        out += "{\"bucket\": ";
+        minipack_json::append_string(out, r.buckets[i].label);
+        out += ", \"entries\": " + std::to_string(r.buckets[i].count) + ", \"bytes\": " + std::to_string(r.buckets[i].bytes) + "}";
+    }
+    out += "\n  ],\n";
+
+    out += "  \"duplicates\": {\"groups\": " + std::to_string(r.duplicates.size()) + ", \"redundant_entries\": " + std::to_string(r.duplicate_entries)
+         + ", \"wasted_bytes\": " + std::to_string(r.duplicate_wasted) + ", \"top\": [";
+    for (size_t i = 0; i < r.duplicates.size() && i < kMaxGroups; ++i) {
+        const DuplicateGroup &g = r.duplicates[i];
+        out += i ? ",\n    " : "\n    ";
+        out += "{\"size\": " + std::to_string(g.size) + ", \"wasted_bytes\": " + std::to_string(g.wasted()) + ", \"names\": [";
+        for (size_t j = 0; j < g.entries.size(); ++j) {
+            if (j) out += ", ";
+            minipack_json::append_string(out, g.entries[j]->name);
+        }
+        out += "]}";
+    }
+    out += r.duplicates.empty() ? "]},\n" : "\n  ]},\n";
+
+    out += "  \"extensions\": [";
+    for (size_t i = 0; i < r.extensions.size(); ++i) {
+        const auto &[ext, s] = r.extensions[i];
+        out += i ? ",\n    " : "\n    ";
+        out += "{\"extension\": ";
+        minipack_json::append_string(out, ext);
+        out += ", \"entries\": " + std::to_string(s.entries) + ", \"bytes\": " + std::to_string(s.bytes) + ", \"sampled_bytes\": " + std::to_string(s.sampled)
+             + ", \"entropy_bits_per_byte\": " + json_number(s.entropy()) + ", \"estimated_bytes\": " + std::to_string(static_cast<uint64_t>(s.estimated_bytes())) + "}";
+    }
+    out += "\n  ],\n";
+
+    const NameTableStats &n = r.names;
+    out += "  \"name_table\": {\"info_size\": " + std::to_string(n.info_size) + ", \"header_size\": " + std::to_string(n.header_size)
+         + ", \"name_bytes\": " + std::to_string(n.name_bytes) + ", \"plain_table_bytes\": " + std::to_string(n.plain_table)
+         + ", \"front_coded_table_bytes\": " + std::to_string(n.front_coded_table) + ", \"index_table_bytes\": " + std::to_string(n.index_tables) + "}";
+
+    if (r.has_access) {
+        const AccessStats &a = r.access;
+        out += ",\n  \"access_log\": {\"accesses\": " + std::to_string(a.accesses) + ", \"misses\": " + std::to_string(a.misses)
+             + ", \"random_ios\": " + std::to_string(a.random_ios) + ", \"sequential_reads\": " + std::to_string(a.sequential)
+             + ", \"bytes\": " + std::to_string(a.bytes) + ", \"skipped_bytes\": " + std::to_string(a.skipped_bytes) + "}";
+    }
+    out += "\n}\n";
+    os << out;
+}
+
+double percent(uint64_t part, uint64_t whole)
+{
+    return whole ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+}
+
+void print_text(const Report &r, std::ostream &os)
+{
+    constexpr size_t kMaxGroups = 10;
+    os << std::fixed << std::setprecision(1);
+    os << "\nSize histogram\n";
+    os << std::left << std::setw(12) << "  Size" << std::right << std::setw(10) << "Entries" << std::setw(16) << "Bytes" << "\n";
+    for (const SizeBucket &b : r.buckets) {
+        if (b.count == 0) continue;
+        os << "  " << std::left << std::setw(10) << b.label << std::right << std::setw(10) << b.count << std::setw(16) << b.bytes << "\n";
+    }
+
+    os << "\nWasted bytes\n";
+    os << "  Duplicates : " << r.duplicates.size() << " groups, " << r.duplicate_entries << " redundant entries, "
+       << r.duplicate_wasted << " bytes (" << percent(r.duplicate_wasted, r.data_bytes) << "% of data)\n";
+    os << "  Padding    : " << r.padding << " bytes (" << percent(r.padding, r.data_area) << "% of the data area)\n";
+    if (r.shared_entries) os << "  Shared     : " << r.shared_entries << " entries already share another entry's bytes\n";
+    for (size_t i = 0; i < r.duplicates.size() && i < kMaxGroups; ++i) {
+        const DuplicateGroup &g = r.duplicates[i];
+        os << "  " << g.entries.size() << " x " << g.size << " bytes:";
+        for (size_t j = 0; j < g.entries.size() && j < 4; ++j) os << " " << g.entries[j]->name;
+        if (g.entries.size() > 4) os << " ...";
+        os << "\n";
+    }
+
+    os << "\nCompressibility (order-0 entropy of sampled bytes; LZ-style codecs may do better)\n";
+    os << std::left << std::setw(12) << "  Ext" << std::right << std::setw(10) << "Entries" << std::setw(16) << "Bytes"
+       << std::setw(14) << "Sampled" << std::setw(10) << "Bits/B" << std::setw(16) << "Est. bytes" << "\n";
+    double estimated = 0.0;
+    for (const auto &[ext, s] : r.extensions) {
+        estimated += s.estimated_bytes();
+        os << "  " << std::left << std::setw(10) << ext << std::right << std::setw(10) << s.entries << std::setw(16) << s.bytes
+           << std::setw(14) << s.sampled << std::setprecision(2) << std::setw(10) << s.entropy() << std::setw(16)
+           << static_cast<uint64_t>(s.estimated_bytes()) << std::setprecision(1) << "\n";
+    }
+    os << "  Estimated total: " << static_cast<uint64_t>(estimated) << " of " << r.data_bytes << " bytes ("
+       << percent(static_cast<uint64_t>(estimated), r.data_bytes) << "%)\n";
+
+    const NameTableStats &n = r.names;
+    const uint64_t pack_size = n.header_size + n.info_size + r.data_area;
+    os << "\nName table\n";
+    os << "  Index      : " << n.header_size + n.info_size << " bytes (" << percent(n.header_size + n.info_size, pack_size) << "% of the pack, "
+       << (r.entries ? static_cast<double>(n.header_size + n.info_size) / static_cast<double>(r.entries) : 0.0) << " bytes per entry)\n";
+    os << "  Names      : " << n.name_bytes << " bytes of names\n";
+    os << "  Plain      : " << n.plain_table << " bytes (v1 length table + NUL-terminated names)\n";
+    os << "  Front-coded: " << n.front_coded_table << " bytes (v2, --front-coded)\n";
+    os << "  Tables     : " << n.index_tables << " bytes (offsets, sizes" << (n.index_tables > 8 * r.entries ? ", volumes" : "") << ")\n";
+
+    if (r.has_access) {
+        const AccessStats &a = r.access;
+        os << "\nAccess log\n";
+        os << "  Accesses   : " << a.accesses << " (" << a.misses << " not in the pack)\n";
+        os << "  Random I/Os: " << a.random_ios << " (" << a.sequential << " reads continue the previous one)\n";
+        os << "  Bytes      : " << a.bytes << " read, " << a.skipped_bytes << " read through in gaps\n";
+    }
+}
+
+} // namespace
+
+bool analyze_minipack(const MiniPackIndex &index, const PackRangeReader &read_range, const PackAnalyzeOptions &options, std::ostream &os, std::string &err)
+{
+    Report report;
+    report.entries = index.file_count();
+    report.buckets = make_buckets();
+    for (const MiniPackEntry &e : index.entries()) {
+        report.data_bytes += e.size;
+        for (SizeBucket &b : report.buckets) {
+            if (e.size < b.limit) {
+                ++b.count;
+                b.bytes += e.size;
+                break;
+            }
+        }
+    }
+
+    if (!find_duplicates(index, read_range, report, err)) return false;
+    if (!sample_extensions(options, index, read_range, report, err)) return false;
+    measure_names(index, report);
+    if (!options.access_log.empty() && !replay_access_log(options, index, report, err)) return false;
+
+    if (options.json) print_json(report, os);
+    else print_text(report, os);
+    return true;
+}
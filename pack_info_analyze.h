@@ -0,0 +1,26 @@
+﻿#pragma once
+
+#include "pack_reader.h"
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// minipack_info --analyze: layout and compressibility report for one pack.
+
+// Reads 'length' bytes at 'offset' inside an entry (one of the readers' read_entry_range).
+using PackRangeReader = std::function<bool(const MiniPackEntry &entry, uint64_t offset, uint64_t length, std::vector<uint8_t> &out, std::string &err)>;
+
+struct PackAnalyzeOptions
+{
+    uint64_t sample_bytes = 64 * 1024;  // bytes per entry sampled for the entropy estimate
+    std::string access_log;             // optional: entry names, one per line, in access order
+    uint64_t readahead = 128 * 1024;    // forward gap still served by the previous sequential read
+    bool json = false;
+};
+
+// Size histogram, duplicate-content groups and wasted bytes, order-0 entropy per
+// extension, name-table overhead and (with an access log) the number of random
+// I/Os the current layout costs. Written to 'os' as text or JSON.
+bool analyze_minipack(const MiniPackIndex &index, const PackRangeReader &read_range, const PackAnalyzeOptions &options, std::ostream &os, std::string &err);
@@ -1,52 +1,178 @@
 ﻿#include <iostream>
 #include <iomanip>
 #include <string>
+#include <cstdint>
+#include <vector>
 
 #include "pack_reader_io.h"
+#include "pack_reader_file.h"
+#include "pack_info_analyze.h"
+#include "pack_reader_memory.h"
+#include "minipack_stats.h"
+#include "minipack_args.h"
 
 int main(int argc, char **argv)
 {
     if (argc < 2) {
-        std::cout << "Usage: " << argv[0] << " <pack_file>\n";
+        std::cout << "Usage: " << argv[0] << " <pack_file> [--offset N [--size N]] [--ls DIR] [--stats] [--analyze [--json] [--access-log FILE] [--sample N]] [--loose DIR]\n";
+        std::cout << "  --offset N   pack starts N bytes into the file (e.g. appended to an executable)\n";
+        std::cout << "  --size N     pack length in bytes (default: to end of file)\n";
+        std::cout << "  --ls DIR     list the immediate children of DIR (\"\" for the root)\n";
+        std::cout << "  --stats      look up and read every entry once, then print reader statistics\n";
+        std::cout << "  --analyze    report size histogram, duplicates, padding, per-extension entropy and name-table overhead\n";
+        std::cout << "  --json       print the --analyze report as JSON\n";
+        std::cout << "  --access-log FILE  entry names in access order; --analyze counts the random I/Os they cost\n";
+        std::cout << "  --sample N   bytes per entry sampled for the entropy estimate (default 65536)\n";
+        std::cout << "  --loose DIR  read entry data from the loose files under DIR (index-only packs)\n";
         return 1;
     }
 
     const std::string pack_path = argv[1];
-    MiniPackIndex index;
+    uint64_t offset = 0, size = 0;
+    bool embedded = false;
+    bool list_dir = false;
+    bool show_stats = false;
+    bool loose = false;
+    bool analyze = false;
+    PackAnalyzeOptions analyze_options;
+    std::string ls_dir, loose_root;
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if ((arg == "--offset" || arg == "--size") && i + 1 < argc) {
+            if (!minipack_args::parse_u64(argv[++i], arg == "--offset" ? offset : size)) {
+                std::cerr << "Invalid " << arg << " value: " << argv[i] << "\n";
+                return 1;
+            }
+            embedded = true;
+        } else if (arg == "--ls" && i + 1 < argc) {
+            ls_dir = argv[++i];
+            list_dir = true;
+        } else if (arg == "--stats") {
+            show_stats = true;
+        } else if (arg == "--analyze") {
+            analyze = true;
+        } else if (arg == "--json") {
+            analyze_options.json = true;
+        } else if (arg == "--access-log" && i + 1 < argc) {
+            analyze_options.access_log = argv[++i];
+        } else if (arg == "--sample" && i + 1 < argc) {
+            if (!minipack_args::parse_u64(argv[++i], analyze_options.sample_bytes)) {
+                std::cerr << "Invalid --sample value: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (arg == "--loose" && i + 1 < argc) {
+            loose_root = argv[++i];
+            loose = true;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    if (loose && embedded) {
+        std::cerr << "--loose cannot be combined with --offset/--size\n";
+        return 1;
+    }
+
+    MiniPackIndex file_index;
+    MiniPackStats stats;
+    MiniPackStats *stats_ptr = show_stats ? &stats : nullptr;
     std::string err;
 
-    if (!load_minipack_index(pack_path, index, err)) {
+    // Embedded packs are read in place through a mapping of the requested range
+    MiniPackMappedFile mapped;
+    MiniPackMemoryReader reader;
+    MiniPackFileReader loose_reader;
+    if (loose || (analyze && !embedded)) {
+        // --analyze reads many entries; keep the pack (or loose files) open for all of them
+        const bool opened = loose ? loose_reader.open_loose(pack_path, loose_root, err, stats_ptr) : loose_reader.open(pack_path, err, stats_ptr);
+        if (!opened) {
+            std::cerr << "Error: " << err << "\n";
+            return 1;
+        }
+    } else if (embedded) {
+        if (!mapped.open(pack_path, offset, size, err) || !reader.open(mapped.bytes(), err, stats_ptr)) {
+            std::cerr << "Error: " << err << "\n";
+            return 1;
+        }
+    } else if (!load_minipack_index(pack_path, file_index, err, stats_ptr)) {
         std::cerr << "Error: " << err << "\n";
         return 1;
     }
+    const MiniPackIndex &index = loose_reader.is_open() ? loose_reader.index() : embedded ? reader.index() : file_index;
+
+    if (analyze) {
+        const PackRangeReader read_range = [&](const MiniPackEntry &e, uint64_t off, uint64_t len, std::vector<uint8_t> &out, std::string &range_err) {
+            return embedded ? reader.read_entry_range(e, off, len, out, range_err) : loose_reader.read_entry_range(e, off, len, out, range_err);
+        };
+        if (!analyze_options.json) {
+            std::cout << "Pack file : " << pack_path << "\n";
+            std::cout << "File count: " << index.file_count() << "\n";
+        }
+        if (!analyze_minipack(index, read_range, analyze_options, std::cout, err)) {
+            std::cerr << "Error: " << err << "\n";
+            return 1;
+        }
+        return 0;
+    }
 
     const auto &entries = index.entries();
     const size_t count = index.file_count();
 
     std::cout << "Pack file : " << pack_path << "\n";
+    if (embedded) std::cout << "Pack range: " << offset << " + " << mapped.bytes().size() << " bytes\n";
     std::cout << "Info size : " << index.info_size() << " bytes\n";
     std::cout << "Data start: " << index.data_start() << " bytes\n";
     std::cout << "File count: " << count << "\n";
+    if (index.volume_count() > 0) std::cout << "Volumes   : " << index.volume_count() << "\n";
 
     if (count == 0) {
         std::cout << "(no entries)\n";
         return 0;
     }
 
+    if (show_stats) {
+        std::vector<uint8_t> data;
+        for (const MiniPackEntry &e : entries) {
+            const MiniPackEntry *found = index.find(e.name);
+            const bool ok = loose ? loose_reader.read_entry(*found, data, err)
+                          : embedded ? reader.read_entry(*found, data, err)
+                          : read_minipack_entry_data(pack_path, *found, data, err, &stats);
+            if (!ok) std::cerr << "Error: " << e.name << ": " << err << "\n";
+        }
+        std::cout << "\n";
+        print_minipack_stats(std::cout, stats.snapshot());
+        return 0;
+    }
+
+    if (list_dir) {
+        std::vector<MiniPackDirEntry> children;
+        index.list_directory(ls_dir, children);
+        std::cout << "\n";
+        for (const MiniPackDirEntry &c : children) {
+            if (c.is_directory) std::cout << std::left << std::setw(12) << "<dir>" << c.name << "/\n";
+            else std::cout << std::left << std::setw(12) << c.entry->size << c.name << "\n";
+        }
+        return 0;
+    }
+
+    const bool volumes = index.volume_count() > 0;
     std::cout << "\n";
     std::cout << std::left
-              << std::setw(6)  << "Index"
-              << std::setw(12) << "Offset"
+              << std::setw(6)  << "Index";
+    if (volumes) std::cout << std::setw(8) << "Volume";
+    std::cout << std::setw(12) << "Offset"
               << std::setw(12) << "Size"
               << "Name"
               << "\n";
-    std::cout << std::string(6 + 12 + 12 + 40, '-') << "\n";
+    std::cout << std::string(6 + (volumes ? 8 : 0) + 12 + 12 + 40, '-') << "\n";
 
     for (size_t i = 0; i < count; ++i) {
         const MiniPackEntry &e = entries[i];
         std::cout << std::left
-                  << std::setw(6)  << i
-                  << std::setw(12) << e.offset
+                  << std::setw(6)  << i;
+        if (volumes) std::cout << std::setw(8) << e.volume;
+        std::cout << std::setw(12) << e.offset
                   << std::setw(12) << e.size
                   << e.name
                   << "\n";
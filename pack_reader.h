@@ -1,15 +1,102 @@
 ﻿#pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <compare>
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <optional>
+#include <span>
+
+class MiniPackStats;
 
 struct MiniPackEntry {
     // Stored filename from the info block as plain bytes (ANSI)
     std::string name;
     uint32_t size = 0;
-    uint32_t offset = 0; // relative to start of data section
+    uint32_t offset = 0; // relative to start of data section, or of the volume file
+    uint32_t volume = 0; // 0: the pack file itself; N: volume file "<pack>.NNN" (multi-volume packs)
+};
+
+// Sub-range reads: true if [offset, offset + length) lies inside the entry's data
+inline bool minipack_check_entry_range(const MiniPackEntry &entry, uint64_t offset, uint64_t length, std::string &err)
+{
+    if (offset > entry.size || length > entry.size - offset) {
+        err = "Range " + std::to_string(offset) + "+" + std::to_string(length) + " is outside entry " + entry.name + " (" + std::to_string(entry.size) + " bytes)";
+        return false;
+    }
+    return true;
+}
+
+// Range of entries in name order, e.g. everything under a prefix. Iterating yields
+// references into the index; no names are copied.
+class MiniPackNameRange {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = MiniPackEntry;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const MiniPackEntry*;
+        using reference = const MiniPackEntry&;
+
+        iterator() = default;
+        iterator(const std::vector<MiniPackEntry> *entries, const uint32_t *pos) : m_entries(entries), m_pos(pos) {}
+
+        reference operator*() const { return (*m_entries)[*m_pos]; }
+        pointer operator->() const { return &(*m_entries)[*m_pos]; }
+        reference operator[](difference_type n) const { return (*m_entries)[m_pos[n]]; }
+
+        // Position of the current entry in MiniPackIndex::entries()
+        uint32_t entry_index() const { return *m_pos; }
+
+        iterator &operator++() { ++m_pos; return *this; }
+        iterator operator++(int) { iterator t = *this; ++m_pos; return t; }
+        iterator &operator--() { --m_pos; return *this; }
+        iterator operator--(int) { iterator t = *this; --m_pos; return t; }
+        iterator &operator+=(difference_type n) { m_pos += n; return *this; }
+        iterator &operator-=(difference_type n) { m_pos -= n; return *this; }
+        iterator operator+(difference_type n) const { return iterator(m_entries, m_pos + n); }
+        iterator operator-(difference_type n) const { return iterator(m_entries, m_pos - n); }
+        difference_type operator-(const iterator &o) const { return m_pos - o.m_pos; }
+
+        bool operator==(const iterator &o) const { return m_pos == o.m_pos; }
+        auto operator<=>(const iterator &o) const { return m_pos <=> o.m_pos; }
+
+    private:
+        const std::vector<MiniPackEntry> *m_entries = nullptr;
+        const uint32_t *m_pos = nullptr;
+    };
+
+    MiniPackNameRange() = default;
+    MiniPackNameRange(iterator b, iterator e) : m_begin(b), m_end(e) {}
+
+    iterator begin() const { return m_begin; }
+    iterator end() const { return m_end; }
+    size_t size() const { return static_cast<size_t>(m_end - m_begin); }
+    bool empty() const { return m_begin == m_end; }
+
+private:
+    iterator m_begin;
+    iterator m_end;
+};
+
+// One immediate child of a directory in the pack. 'name' is the last path
+// component and views into the index, so it lives as long as the index does.
+struct MiniPackDirEntry {
+    std::string_view name;
+    bool is_directory = false;
+    const MiniPackEntry *entry = nullptr; // set for files only
+};
+
+// Byte range inside a pack, relative to the start of the pack (header included),
+// or to the start of volume file 'volume' for multi-volume packs.
+struct MiniPackByteRange {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint32_t volume = 0;
 };
 
 class MiniPackIndex {
@@ -18,6 +105,11 @@ public:
 
     void clear();
 
+    // Optional metrics sink (see minipack_stats.h); find() records lookups and misses.
+    // The loaders attach the stats they were given. Must outlive the index.
+    void set_stats(MiniPackStats *stats) { m_stats = stats; }
+    MiniPackStats *stats() const { return m_stats; }
+
     // Number of entries in the pack
     size_t file_count() const;
 
@@ -27,17 +119,46 @@ public:
     uint64_t info_size() const;
     uint64_t data_start() const;
 
+    // Number of volume files holding the data; 0 for single-file packs.
+    uint32_t volume_count() const { return m_volume_count; }
+
+    // Name lookups use a byte-wise sorted order built when the index is loaded.
+    // Exact match; nullptr if absent.
+    const MiniPackEntry *find(std::string_view name) const;
+
+    // All entries in name order.
+    MiniPackNameRange sorted() const;
+
+    // Entries whose name starts with 'prefix' (e.g. "textures/ui/"), in name order.
+    MiniPackNameRange with_prefix(std::string_view prefix) const;
+
+    // Immediate children of directory 'dir' ("" for the root; a trailing '/' is optional).
+    // Subdirectories are reported once each and skipped over by binary search.
+    void list_directory(std::string_view dir, std::vector<MiniPackDirEntry> &out) const;
+
+    // Byte ranges holding the data of 'entries', sorted by volume and offset. Ranges that overlap
+    // or lie within 'merge_gap' bytes of each other are joined; empty entries are skipped.
+    void byte_ranges(std::span<const MiniPackEntry* const> entries, std::vector<MiniPackByteRange> &out, uint64_t merge_gap = 0) const;
+    void byte_ranges(const MiniPackNameRange &entries, std::vector<MiniPackByteRange> &out, uint64_t merge_gap = 0) const;
+
 private:
     // Internal population: loader will write directly into m_entries via friendship
     void set_info_size(uint64_t s);
     void set_data_start(uint64_t s);
+    void build_name_order();
+
+    MiniPackNameRange::iterator order_iterator(size_t pos) const;
 
     std::vector<MiniPackEntry> m_entries;
+    std::vector<uint32_t> m_name_order; // entry indices sorted by name
     uint64_t m_info_size = 0;
     uint64_t m_data_start = 0; // file offset where data section begins
+    uint32_t m_volume_count = 0;
+    MiniPackStats *m_stats = nullptr;
 
     // Allow IO loader to populate the index
-    friend bool load_minipack_index(const std::string &path, MiniPackIndex &index, std::string &err);
+    friend bool load_minipack_index(const std::string &path, MiniPackIndex &index, std::string &err, MiniPackStats *stats);
+    friend bool load_minipack_index_from_memory(const uint8_t *data, size_t size, MiniPackIndex &index, std::string &err, MiniPackStats *stats);
 };
 
 // File I/O helpers are provided in pack_reader_io.h / .cpp
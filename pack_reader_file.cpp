@@ -0,0 +1,196 @@
+﻿#include "pack_reader_file.h"
+#include "pack_reader_io.h"
+#include "minipack_format.h"
+#include "minipack_stats.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include "utf_conv.h"
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::intptr_t kNoFile = -1;
+
+// Thin platform layer: open read-only, positional read, close
+#ifdef _WIN32
+std::intptr_t os_open_read(const std::string &path)
+{
+    std::u16string wpath;
+    if (!utf8_to_utf16(path, wpath)) return kNoFile;
+    HANDLE h = CreateFileW(reinterpret_cast<LPCWSTR>(wpath.c_str()), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    return h == INVALID_HANDLE_VALUE ? kNoFile : reinterpret_cast<std::intptr_t>(h);
+}
+
+bool os_read_at(std::intptr_t file, uint64_t offset, uint8_t *dst, size_t size)
+{
+    while (size > 0) {
+        OVERLAPPED ov{};
+        ov.Offset = static_cast<DWORD>(offset & 0xFFFFFFFFu);
+        ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD got = 0;
+        const DWORD want = static_cast<DWORD>(size > 0x40000000 ? 0x40000000 : size);
+        if (!ReadFile(reinterpret_cast<HANDLE>(file), dst, want, &got, &ov) || got == 0) return false;
+        dst += got;
+        size -= got;
+        offset += got;
+    }
+    return true;
+}
+
+void os_close(std::intptr_t file) { CloseHandle(reinterpret_cast<HANDLE>(file)); }
+#else
+std::intptr_t os_open_read(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    return fd < 0 ? kNoFile : fd;
+}
+
+bool os_read_at(std::intptr_t file, uint64_t offset, uint8_t *dst, size_t size)
+{
+    while (size > 0) {
+        const ssize_t n = ::pread(static_cast<int>(file), dst, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        dst += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+void os_close(std::intptr_t file) { ::close(static_cast<int>(file)); }
+#endif
+
+} // namespace
+
+struct MiniPackFileReader::LooseFile {
+    std::intptr_t handle = kNoFile;
+    ~LooseFile() { if (handle != kNoFile) os_close(handle); }
+};
+
+MiniPackFileReader::~MiniPackFileReader()
+{
+    close();
+}
+
+bool MiniPackFileReader::open(const std::string &path, std::string &err, MiniPackStats *stats)
+{
+    close();
+    if (!load_minipack_index(path, m_index, err, stats)) return false;
+    m_path = path;
+    m_stats = stats;
+    m_files.assign(static_cast<size_t>(m_index.volume_count()) + 1, kNoFile);
+    return true;
+}
+
+bool MiniPackFileReader::open_loose(const std::string &path, const std::string &source_root, std::string &err, MiniPackStats *stats, size_t max_open_files)
+{
+    if (!open(path, err, stats)) return false;
+    m_loose_root = source_root;
+    if (!m_loose_root.empty() && m_loose_root.back() != '/' && m_loose_root.back() != '\\') m_loose_root += '/';
+    m_max_loose_files = max_open_files > 0 ? max_open_files : 1;
+    return true;
+}
+
+void MiniPackFileReader::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (std::intptr_t f : m_files)
+        if (f != kNoFile) os_close(f);
+    m_files.clear();
+    // Handles still held by a concurrent read close when that read drops them
+    m_loose_files.clear();
+    m_loose_lru.clear();
+    m_loose_root.clear();
+    m_max_loose_files = 0;
+    m_index.clear();
+    m_path.clear();
+    m_stats = nullptr;
+}
+
+size_t MiniPackFileReader::open_file_count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t n = m_loose_lru.size();
+    for (std::intptr_t f : m_files) n += f != kNoFile;
+    return n;
+}
+
+bool MiniPackFileReader::loose_file_for(const std::string &name, LooseFileRef &file, std::string &err) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_loose_files.find(name);
+    if (it != m_loose_files.end()) {
+        m_loose_lru.splice(m_loose_lru.begin(), m_loose_lru, it->second);
+        file = it->second->second;
+        return true;
+    }
+    const std::string path = m_loose_root + name;
+    auto opened = std::make_shared<LooseFile>();
+    opened->handle = os_open_read(path);
+    if (opened->handle == kNoFile) { err = "Failed to open loose file: " + path; return false; }
+    if (m_loose_lru.size() >= m_max_loose_files) {
+        m_loose_files.erase(m_loose_lru.back().first);
+        m_loose_lru.pop_back();
+    }
+    m_loose_lru.emplace_front(name, opened);
+    m_loose_files.emplace(name, m_loose_lru.begin());
+    file = std::move(opened);
+    return true;
+}
+
+bool MiniPackFileReader::file_for(uint32_t slot, std::intptr_t &file, std::string &err) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (slot >= m_files.size()) { err = "Entry volume out of range"; return false; }
+    if (m_files[slot] == kNoFile) {
+        const std::string path = slot == 0 ? m_path : minipack_format::volume_path(m_path, slot);
+        m_files[slot] = os_open_read(path);
+        if (m_files[slot] == kNoFile) { err = "Failed to open pack file: " + path; return false; }
+    }
+    file = m_files[slot];
+    return true;
+}
+
+bool MiniPackFileReader::read_entry(const MiniPackEntry &entry, std::vector<uint8_t> &out, std::string &err) const
+{
+    return read_entry_range(entry, 0, entry.size, out, err);
+}
+
+bool MiniPackFileReader::read_entry_range(const MiniPackEntry &entry, uint64_t offset, uint64_t length, std::vector<uint8_t> &out, std::string &err) const
+{
+    const auto start = MiniPackStats::start();
+    auto done = [&](bool ok) {
+        if (m_stats) m_stats->record_read(entry.name, start, length, ok);
+        return ok;
+    };
+    if (!minipack_check_entry_range(entry, offset, length, err)) return done(false);
+    out.resize(static_cast<size_t>(length));
+    if (is_loose()) {
+        LooseFileRef loose;
+        if (!loose_file_for(entry.name, loose, err)) return done(false);
+        if (length > 0 && !os_read_at(loose->handle, offset, out.data(), out.size())) {
+            err = "Failed to read loose file (shorter than indexed?): " + m_loose_root + entry.name;
+            return done(false);
+        }
+        return done(true);
+    }
+    std::intptr_t file = kNoFile;
+    if (!file_for(entry.volume, file, err)) return done(false);
+    const uint64_t file_offset = (entry.volume == 0 ? m_index.data_start() : 0) + entry.offset + offset;
+    if (length > 0 && !os_read_at(file, file_offset, out.data(), out.size())) {
+        err = "Failed to read file data from pack";
+        return done(false);
+    }
+    return done(true);
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include "pack_reader.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reader over a pack file on disk that keeps its files open between reads: the
+// pack itself and, for multi-volume packs, each volume file, opened on first use.
+// Reads are positional, so one reader can be shared by several threads.
+//
+// Loose mode (development): open_loose takes a pack written with --index-only and
+// the directory it was built from, and reads each entry from the original file
+// '<source_root>/<entry name>' instead (the name as is for an empty root), through
+// a cache of open files. Lookups and read_entry behave as for a full pack, so code
+// using the reader does not change.
+class MiniPackFileReader {
+public:
+    MiniPackFileReader() = default;
+    ~MiniPackFileReader();
+
+    MiniPackFileReader(const MiniPackFileReader &) = delete;
+    MiniPackFileReader &operator=(const MiniPackFileReader &) = delete;
+
+    // Load the index of 'path'; 'stats' (optional, minipack_stats.h) records the load, lookups and reads.
+    bool open(const std::string &path, std::string &err, MiniPackStats *stats = nullptr);
+    // Load the index of 'path' and read entry data from loose files under 'source_root';
+    // at most 'max_open_files' of them are kept open (least recently used are closed).
+    bool open_loose(const std::string &path, const std::string &source_root, std::string &err, MiniPackStats *stats = nullptr, size_t max_open_files = 64);
+    void close();
+
+    bool is_open() const { return !m_path.empty(); }
+    bool is_loose() const { return m_max_loose_files > 0; }
+
+    const MiniPackIndex &index() const { return m_index; }
+    const std::string &path() const { return m_path; }
+
+    // Copy an entry's data into 'out', reading from the file that holds it.
+    bool read_entry(const MiniPackEntry &entry, std::vector<uint8_t> &out, std::string &err) const;
+    // Copy 'length' bytes starting 'offset' bytes into the entry; only that window is read.
+    bool read_entry_range(const MiniPackEntry &entry, uint64_t offset, uint64_t length, std::vector<uint8_t> &out, std::string &err) const;
+
+    // Number of pack/volume files (or cached loose files) currently open.
+    size_t open_file_count() const;
+
+private:
+    struct LooseFile;
+    using LooseFileRef = std::shared_ptr<const LooseFile>;
+    using LooseList = std::list<std::pair<std::string, LooseFileRef>>;
+
+    // Native handle of file 'slot' (0 = pack, N = volume N), opened on first use
+    bool file_for(uint32_t slot, std::intptr_t &file, std::string &err) const;
+    // Cached handle of an entry's loose file; stays open while the caller holds it
+    bool loose_file_for(const std::string &name, LooseFileRef &file, std::string &err) const;
+
+    std::string m_path;
+    MiniPackIndex m_index;
+    MiniPackStats *m_stats = nullptr;
+    mutable std::mutex m_mutex;
+    mutable std::vector<std::intptr_t> m_files; // -1 until opened
+    std::string m_loose_root;
+    size_t m_max_loose_files = 0; // 0 = not in loose mode
+    mutable LooseList m_loose_lru; // most recently used first
+    mutable std::unordered_map<std::string, LooseList::iterator> m_loose_files;
+};
@@ -1,11 +1,18 @@
 ﻿#include "pack_reader.h"
+#include "minipack_parallel.h"
+#include "minipack_stats.h"
+
+#include <algorithm>
 
 MiniPackIndex::MiniPackIndex() = default;
 
 void MiniPackIndex::clear() {
     m_entries.clear();
+    m_name_order.clear();
     m_info_size = 0;
     m_data_start = 0;
+    m_volume_count = 0;
+    m_stats = nullptr;
 }
 
 size_t MiniPackIndex::file_count() const { return m_entries.size(); }
@@ -17,3 +24,149 @@ void MiniPackIndex::set_data_start(uint64_t s) { m_data_start = s; }
 
 uint64_t MiniPackIndex::info_size() const { return m_info_size; }
 uint64_t MiniPackIndex::data_start() const { return m_data_start; }
+
+void MiniPackIndex::build_name_order()
+{
+    m_name_order.resize(m_entries.size());
+    for (size_t i = 0; i < m_entries.size(); ++i) m_name_order[i] = static_cast<uint32_t>(i);
+
+    auto less = [this](uint32_t a, uint32_t b) {
+        return std::string_view(m_entries[a].name) < std::string_view(m_entries[b].name);
+    };
+    // Packs built from a directory scan are already in name order
+    if (std::is_sorted(m_name_order.begin(), m_name_order.end(), less)) return;
+
+    // Large indexes: sort slices on several threads, then merge neighbours pairwise
+    // (each round in parallel). Both steps are stable, like a single stable_sort.
+    const size_t chunks = minipack_parallel::chunk_count(m_name_order.size());
+    std::vector<size_t> bounds(chunks + 1);
+    for (size_t c = 0; c <= chunks; ++c) bounds[c] = m_name_order.size() * c / chunks;
+    auto at = [this](size_t pos) { return m_name_order.begin() + static_cast<std::ptrdiff_t>(pos); };
+    minipack_parallel::for_chunks(m_name_order.size(), chunks, [&](size_t, size_t begin, size_t end) {
+        std::stable_sort(at(begin), at(end), less);
+    });
+    for (size_t width = 1; width < chunks; width *= 2) {
+        const size_t merges = (chunks + 2 * width - 1) / (2 * width);
+        minipack_parallel::for_chunks(merges, merges, [&](size_t m, size_t, size_t) {
+            const size_t first = 2 * width * m;
+            const size_t mid = std::min(first + width, chunks);
+            const size_t last = std::min(first + 2 * width, chunks);
+            if (mid < last) std::inplace_merge(at(bounds[first]), at(bounds[mid]), at(bounds[last]), less);
+        });
+    }
+}
+
+MiniPackNameRange::iterator MiniPackIndex::order_iterator(size_t pos) const
+{
+    return MiniPackNameRange::iterator(&m_entries, m_name_order.data() + pos);
+}
+
+namespace {
+
+// Index into the sorted order of the first name not less than 'key'
+template<typename Order, typename Entries>
+size_t lower_bound_name(const Order &order, const Entries &entries, std::string_view key)
+{
+    auto it = std::lower_bound(order.begin(), order.end(), key, [&](uint32_t i, std::string_view k) {
+        return std::string_view(entries[i].name) < k;
+    });
+    return static_cast<size_t>(it - order.begin());
+}
+
+}
+
+const MiniPackEntry *MiniPackIndex::find(std::string_view name) const
+{
+    const size_t pos = lower_bound_name(m_name_order, m_entries, name);
+    const MiniPackEntry *found = nullptr;
+    if (pos != m_name_order.size() && m_entries[m_name_order[pos]].name == name) found = &m_entries[m_name_order[pos]];
+    if (m_stats) m_stats->record_lookup(found != nullptr);
+    return found;
+}
+
+MiniPackNameRange MiniPackIndex::sorted() const
+{
+    return MiniPackNameRange(order_iterator(0), order_iterator(m_name_order.size()));
+}
+
+MiniPackNameRange MiniPackIndex::with_prefix(std::string_view prefix) const
+{
+    const size_t first = lower_bound_name(m_name_order, m_entries, prefix);
+    // Names sharing the prefix are contiguous in sorted order
+    auto it = std::partition_point(m_name_order.begin() + first, m_name_order.end(), [&](uint32_t i) {
+        return std::string_view(m_entries[i].name).starts_with(prefix);
+    });
+    return MiniPackNameRange(order_iterator(first), order_iterator(static_cast<size_t>(it - m_name_order.begin())));
+}
+
+void MiniPackIndex::list_directory(std::string_view dir, std::vector<MiniPackDirEntry> &out) const
+{
+    out.clear();
+    std::string prefix(dir);
+    if (!prefix.empty() && prefix.back() != '/') prefix.push_back('/');
+
+    const MiniPackNameRange range = with_prefix(prefix);
+    std::string skip_key;
+    auto it = range.begin();
+    while (it != range.end()) {
+        const std::string_view rest = std::string_view(it->name).substr(prefix.size());
+        const size_t slash = rest.find('/');
+        if (slash == std::string_view::npos) {
+            out.push_back(MiniPackDirEntry{rest, false, &*it});
+            ++it;
+            continue;
+        }
+
+        out.push_back(MiniPackDirEntry{rest.substr(0, slash), true, nullptr});
+        // Jump past "<prefix><child>/..." : '0' is the byte right after '/'
+        skip_key.assign(prefix);
+        skip_key.append(rest.substr(0, slash));
+        skip_key.push_back('0');
+        it = std::lower_bound(it, range.end(), std::string_view(skip_key), [](const MiniPackEntry &e, std::string_view k) {
+            return std::string_view(e.name) < k;
+        });
+    }
+}
+
+namespace {
+
+// Sort by volume and offset and join ranges of the same file that overlap or are
+// at most 'merge_gap' apart
+void merge_byte_ranges(std::vector<MiniPackByteRange> &ranges, uint64_t merge_gap)
+{
+    if (ranges.empty()) return;
+    std::sort(ranges.begin(), ranges.end(), [](const MiniPackByteRange &a, const MiniPackByteRange &b) {
+        return a.volume != b.volume ? a.volume < b.volume : a.offset < b.offset;
+    });
+    size_t last = 0;
+    for (size_t i = 1; i < ranges.size(); ++i) {
+        MiniPackByteRange &cur = ranges[last];
+        const uint64_t end = cur.offset + cur.size;
+        if (ranges[i].volume == cur.volume && ranges[i].offset <= end + merge_gap) {
+            cur.size = std::max(end, ranges[i].offset + ranges[i].size) - cur.offset;
+        } else {
+            ranges[++last] = ranges[i];
+        }
+    }
+    ranges.resize(last + 1);
+}
+
+}
+
+void MiniPackIndex::byte_ranges(std::span<const MiniPackEntry* const> entries, std::vector<MiniPackByteRange> &out, uint64_t merge_gap) const
+{
+    out.clear();
+    out.reserve(entries.size());
+    for (const MiniPackEntry *e : entries)
+        if (e && e->size > 0) out.push_back(MiniPackByteRange{(e->volume ? 0 : m_data_start) + e->offset, e->size, e->volume});
+    merge_byte_ranges(out, merge_gap);
+}
+
+void MiniPackIndex::byte_ranges(const MiniPackNameRange &entries, std::vector<MiniPackByteRange> &out, uint64_t merge_gap) const
+{
+    out.clear();
+    out.reserve(entries.size());
+    for (const MiniPackEntry &e : entries)
+        if (e.size > 0) out.push_back(MiniPackByteRange{(e.volume ? 0 : m_data_start) + e.offset, e.size, e.volume});
+    merge_byte_ranges(out, merge_gap);
+}
@@ -2,12 +2,171 @@
 #include "pack_reader.h"
 #include "utf_conv.h"
 #include "minipack_format.h"
+#include "minipack_name_table.h"
+#include "minipack_parallel.h"
+#include "minipack_stats.h"
 
+#include <algorithm>
 #include <fstream>
 #include <cstring>
+#include <limits>
 
-bool load_minipack_index(const std::string &path, MiniPackIndex &index, std::string &err)
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Parse an info block (everything after the info_size field) into entries.
+// Large indexes are decoded in slices on several threads (minipack_parallel.h);
+// each slice stops at its first bad entry and the lowest one is reported, so the
+// error is the one a single pass would have hit first.
+bool parse_minipack_info(const uint8_t *info, size_t info_size, std::vector<MiniPackEntry> &entries, uint32_t &volume_count, std::string &err)
+{
+    volume_count = 0;
+    size_t pos = 0;
+    auto read_u32 = [&](uint32_t &out) -> bool {
+        return minipack_format::read_u32_le(info, info_size, pos, out);
+    };
+    uint32_t version = 0;
+    if (!read_u32(version)) { err = "Info block corrupted (version)"; return false; }
+    uint32_t file_count = 0;
+    if (!read_u32(file_count)) { err = "Info block corrupted (file_count)"; return false; }
+
+    uint32_t flags = 0;
+    if (version == minipack_format::kVersion2) {
+        if (!read_u32(flags)) { err = "Info block corrupted (flags)"; return false; }
+        // Bits from a newer writer would change the layout; refuse rather than misread it
+        if (flags & ~(minipack_format::kFlagFrontCodedNames | minipack_format::kFlagVolumes)) {
+            err = "Unsupported pack flags " + std::to_string(flags);
+            return false;
+        }
+    } else if (version != minipack_format::kVersion) {
+        err = "Unsupported pack version " + std::to_string(version);
+        return false;
+    }
+
+    const size_t chunks = minipack_parallel::chunk_count(file_count);
+    if (flags & minipack_format::kFlagFrontCodedNames) {
+        minipack_format::FrontCodedNames names;
+        if (!names.open(info, info_size, pos, file_count)) { err = "Info block corrupted (name table)"; return false; }
+        entries.resize(file_count);
+        // Blocks decode independently; slices start on block boundaries
+        std::vector<char> ok(chunks, 1);
+        minipack_parallel::for_chunks(names.block_count(), chunks, [&](size_t c, size_t begin, size_t end) {
+            ok[c] = names.for_each_in_blocks(static_cast<uint32_t>(begin), static_cast<uint32_t>(end),
+                                             [&](uint32_t i, const std::string &name) { entries[i].name = name; });
+        });
+        if (std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+            err = "Info block corrupted (names area)";
+            return false;
+        }
+    } else {
+        // Read name lengths block (file_count bytes)
+        if (pos + file_count > info_size) { err = "Info block corrupted (name lengths)"; return false; }
+        const uint8_t *name_lengths = info + pos;
+        pos += file_count;
+
+        // Names follow each other as raw bytes plus a NUL, so where each slice's
+        // names start is a prefix sum over the length table
+        std::vector<uint64_t> slice_start(chunks + 1, 0);
+        minipack_parallel::for_chunks(file_count, chunks, [&](size_t c, size_t begin, size_t end) {
+            uint64_t bytes = end - begin;
+            for (size_t i = begin; i < end; ++i) bytes += name_lengths[i];
+            slice_start[c + 1] = bytes;
+        });
+        for (size_t c = 0; c < chunks; ++c) slice_start[c + 1] += slice_start[c];
+
+        // Read all names as raw bytes, each followed by a NUL terminator
+        constexpr size_t kNoError = std::numeric_limits<size_t>::max();
+        std::vector<size_t> bad_entry(chunks, kNoError);
+        std::vector<const char*> bad_reason(chunks, nullptr);
+        entries.resize(file_count);
+        minipack_parallel::for_chunks(file_count, chunks, [&](size_t c, size_t begin, size_t end) {
+            uint64_t p = pos + slice_start[c];
+            for (size_t i = begin; i < end; ++i) {
+                const uint32_t len = name_lengths[i];
+                if (p + len + 1 > info_size) { bad_entry[c] = i; bad_reason[c] = "Info block corrupted (names area)"; return; }
+                if (len > 0) entries[i].name.assign(reinterpret_cast<const char*>(info + p), len);
+                p += len;
+                if (info[p++] != 0) { bad_entry[c] = i; bad_reason[c] = "Info block corrupted (missing NUL after name)"; return; }
+            }
+        });
+        for (size_t c = 0; c < chunks; ++c) {
+            if (bad_entry[c] != kNoError) { err = bad_reason[c]; return false; }
+        }
+        pos += slice_start[chunks];
+    }
+
+    // Read metadata: first all data_offsets, then all data_sizes
+    if (pos + 2 * minipack_format::kU32Size * static_cast<size_t>(file_count) > info_size) {
+        // Report the same block the sequential reads below would have failed on
+        if (pos + minipack_format::kU32Size * static_cast<size_t>(file_count) > info_size) { err = "Info block corrupted (offsets)"; return false; }
+        err = "Info block corrupted (sizes)";
+        return false;
+    }
+    const uint8_t *offsets = info + pos;
+    const uint8_t *sizes = offsets + minipack_format::kU32Size * file_count;
+    pos += 2 * minipack_format::kU32Size * static_cast<size_t>(file_count);
+
+    // All table bounds are checked up front; decoding itself can then only fail on a bad volume number
+    const uint8_t *volumes = nullptr;
+    if (flags & minipack_format::kFlagVolumes) {
+        if (!read_u32(volume_count) || volume_count == 0) { err = "Info block corrupted (volume count)"; return false; }
+        if (pos + minipack_format::kU32Size * static_cast<size_t>(file_count) > info_size) { err = "Info block corrupted (volumes)"; return false; }
+        volumes = info + pos;
+    }
+    std::vector<char> ok(chunks, 1);
+    minipack_parallel::for_chunks(file_count, chunks, [&](size_t c, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            MiniPackEntry &e = entries[i];
+            e.offset = minipack_format::read_u32_le_4(offsets + minipack_format::kU32Size * i);
+            e.size = minipack_format::read_u32_le_4(sizes + minipack_format::kU32Size * i);
+            if (!volumes) continue;
+            e.volume = minipack_format::read_u32_le_4(volumes + minipack_format::kU32Size * i);
+            if (e.volume > volume_count || (e.volume == 0 && e.size != 0)) { ok[c] = 0; return; }
+        }
+    });
+    if (std::find(ok.begin(), ok.end(), 0) != ok.end()) { err = "Info block corrupted (volumes)"; return false; }
+    return true;
+}
+
+// Validate the fixed header at the start of 'data' and return the info block size.
+bool parse_minipack_header(const uint8_t *data, size_t size, uint32_t &info_size, std::string &err)
 {
+    if (size < minipack_format::kMagicSize) { err = "Failed to read pack header"; return false; }
+    if (std::memcmp(data, minipack_format::kMagic, minipack_format::kMagicSize) != 0) { err = "Invalid pack magic"; return false; }
+    if (size < minipack_format::kInfoBlockOffset) { err = "Failed to read info size"; return false; }
+    info_size = minipack_format::read_u32_le_4(data + minipack_format::kInfoSizeOffset);
+    if (size - minipack_format::kInfoBlockOffset < info_size) { err = "Failed to read info block"; return false; }
+    return true;
+}
+
+// Records an index load when the loader returns and attaches the stats to the
+// index. A loaded index always has a non-empty info block, so info_size tells
+// success from failure.
+class IndexLoadRecorder {
+public:
+    IndexLoadRecorder(MiniPackIndex &index, MiniPackStats *stats) : m_index(index), m_stats(stats), m_start(MiniPackStats::start()) {}
+    ~IndexLoadRecorder()
+    {
+        if (!m_stats) return;
+        m_stats->record_index_load(m_start, m_index.info_size(), m_index.info_size() != 0);
+        m_index.set_stats(m_stats);
+    }
+
+private:
+    MiniPackIndex &m_index;
+    MiniPackStats *m_stats;
+    MiniPackStats::Clock::time_point m_start;
+};
+
+} // namespace
+
+bool load_minipack_index(const std::string &path, MiniPackIndex &index, std::string &err, MiniPackStats *stats)
+{
+    IndexLoadRecorder recorder(index, stats);
     index.clear();
     std::ifstream in(path, std::ios::binary);
     if (!in) { err = "Failed to open pack file: " + path; return false; }
@@ -26,80 +185,155 @@ bool load_minipack_index(const std::string &path, MiniPackIndex &index, std::str
     in.read(reinterpret_cast<char*>(info.data()), static_cast<std::streamsize>(info_size));
     if (static_cast<size_t>(in.gcount()) != info_size) { err = "Failed to read info block"; return false; }
 
-    size_t pos = 0;
-    auto read_u32 = [&](uint32_t &out) -> bool {
-        return minipack_format::read_u32_le(info, pos, out);
-    };
-    uint32_t version = 0;
-    if (!read_u32(version)) { err = "Info block corrupted (version)"; return false; }
-    uint32_t file_count = 0;
-    if (!read_u32(file_count)) { err = "Info block corrupted (file_count)"; return false; }
-
-    // Read name lengths block (file_count bytes)
-    if (pos + file_count > info.size()) { err = "Info block corrupted (name lengths)"; return false; }
-    std::vector<uint8_t> name_lengths(file_count);
-    for (uint32_t i = 0; i < file_count; ++i) name_lengths[i] = info[pos++];
-
-    index.m_entries.reserve(file_count);
-
-    // Read all names as raw bytes, each followed by a NUL terminator
-    for (uint32_t i = 0; i < file_count; ++i) {
-        uint32_t len = name_lengths[i];
-        if (pos + len + 1 > info.size()) { err = "Info block corrupted (names area)"; return false; }
-        std::string name;
-        if (len > 0) {
-            name.assign(reinterpret_cast<const char*>(&info[pos]), len);
-        }
-        pos += len;
-        if (info[pos++] != 0) { err = "Info block corrupted (missing NUL after name)"; return false; }
+    if (!parse_minipack_info(info.data(), info.size(), index.m_entries, index.m_volume_count, err)) { index.m_entries.clear(); index.m_volume_count = 0; return false; }
 
-        MiniPackEntry e;
-        e.name = std::move(name);
-        index.m_entries.push_back(std::move(e));
-    }
+    index.build_name_order();
+    index.set_info_size(info_size);
+    index.set_data_start(minipack_format::data_start_offset(info_size));
+    return true;
+}
 
-    // Read metadata: first all data_offsets, then all data_sizes
-    std::vector<uint32_t> offsets(file_count, 0);
-    for (uint32_t i = 0; i < file_count; ++i) {
-        if (!read_u32(offsets[i])) { err = "Info block corrupted (offsets)"; return false; }
-    }
-    for (uint32_t i = 0; i < file_count; ++i) {
-        uint32_t sz = 0;
-        if (!read_u32(sz)) { err = "Info block corrupted (sizes)"; return false; }
-        index.m_entries[i].size = sz;
-        index.m_entries[i].offset = offsets[i];
-    }
+bool load_minipack_index_from_memory(const uint8_t *data, size_t size, MiniPackIndex &index, std::string &err, MiniPackStats *stats)
+{
+    IndexLoadRecorder recorder(index, stats);
+    index.clear();
+    uint32_t info_size = 0;
+    if (!parse_minipack_header(data, size, info_size, err)) return false;
+    if (!parse_minipack_info(data + minipack_format::kInfoBlockOffset, info_size, index.m_entries, index.m_volume_count, err)) { index.m_entries.clear(); index.m_volume_count = 0; return false; }
 
+    index.build_name_order();
     index.set_info_size(info_size);
     index.set_data_start(minipack_format::data_start_offset(info_size));
     return true;
 }
 
-bool read_minipack_entry_data(const std::string &path, const MiniPackEntry &entry, std::vector<uint8_t> &out, std::string &err)
+bool read_minipack_entry_data(const std::string &path, const MiniPackEntry &entry, std::vector<uint8_t> &out, std::string &err, MiniPackStats *stats)
 {
+    return read_minipack_entry_range(path, entry, 0, entry.size, out, err, stats);
+}
+
+bool read_minipack_entry_range(const std::string &path, const MiniPackEntry &entry, uint64_t offset, uint64_t length, std::vector<uint8_t> &out, std::string &err, MiniPackStats *stats)
+{
+    const auto start = MiniPackStats::start();
+    auto done = [&](bool ok) {
+        if (stats) stats->record_read(entry.name, start, length, ok);
+        return ok;
+    };
+    if (!minipack_check_entry_range(entry, offset, length, err)) return done(false);
+    // Entries of multi-volume packs are read straight from their volume file
+    if (entry.volume != 0) {
+        const std::string volume_path = minipack_format::volume_path(path, entry.volume);
+        std::ifstream vin(volume_path, std::ios::binary);
+        if (!vin) { err = "Failed to open pack volume for reading: " + volume_path; return done(false); }
+        vin.seekg(static_cast<std::streamoff>(entry.offset + offset), std::ios::beg);
+        out.resize(static_cast<size_t>(length));
+        vin.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(length));
+        if (vin.gcount() != static_cast<std::streamsize>(length)) { err = "Failed to read file data from pack volume"; return done(false); }
+        return done(true);
+    }
     std::ifstream in(path, std::ios::binary);
-    if (!in) { err = "Failed to open pack for reading: " + path; return false; }
+    if (!in) { err = "Failed to open pack for reading: " + path; return done(false); }
     // compute data start by reading header again
     // seek to info size
     in.seekg(static_cast<std::streamoff>(minipack_format::kInfoSizeOffset), std::ios::beg);
     uint8_t b[4];
     in.read(reinterpret_cast<char*>(b), 4);
-    if (in.gcount() != 4) { err = "Failed to read info size"; return false; }
+    if (in.gcount() != 4) { err = "Failed to read info size"; return done(false); }
     uint32_t info_size = minipack_format::read_u32_le_4(b);
     std::uint64_t data_start = minipack_format::data_start_offset(info_size);
-    in.seekg(static_cast<std::streamoff>(data_start + entry.offset), std::ios::beg);
-    out.resize(entry.size);
-    in.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(entry.size));
-    if (in.gcount() != static_cast<std::streamsize>(entry.size)) { err = "Failed to read file data from pack"; return false; }
-    return true;
+    in.seekg(static_cast<std::streamoff>(data_start + entry.offset + offset), std::ios::beg);
+    out.resize(static_cast<size_t>(length));
+    in.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(length));
+    if (in.gcount() != static_cast<std::streamsize>(length)) { err = "Failed to read file data from pack"; return done(false); }
+    return done(true);
 }
 
-bool extract_minipack_entry_to_file(const std::string &path, const MiniPackEntry &entry, const std::string &out_path, std::string &err)
+bool extract_minipack_entry_to_file(const std::string &path, const MiniPackEntry &entry, const std::string &out_path, std::string &err, MiniPackStats *stats)
 {
     std::vector<uint8_t> data;
-    if (!read_minipack_entry_data(path, entry, data, err)) return false;
+    if (!read_minipack_entry_data(path, entry, data, err, stats)) return false;
     std::ofstream out(out_path, std::ios::binary);
     if (!out) { err = "Failed to create output file: " + out_path; return false; }
     if (!data.empty()) out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
     return true;
 }
+
+bool read_minipack_entry_data_from_memory(const uint8_t *data, size_t size, const MiniPackEntry &entry, std::vector<uint8_t> &out, std::string &err, MiniPackStats *stats)
+{
+    const auto start = MiniPackStats::start();
+    auto done = [&](bool ok) {
+        if (stats) stats->record_read(entry.name, start, entry.size, ok);
+        return ok;
+    };
+    if (entry.volume != 0) { err = "Entry is stored in volume " + std::to_string(entry.volume) + ", not in the pack bytes"; return done(false); }
+    uint32_t info_size = 0;
+    if (!parse_minipack_header(data, size, info_size, err)) return done(false);
+    const uint64_t begin = minipack_format::data_start_offset(info_size) + entry.offset;
+    if (begin > size || size - begin < entry.size) { err = "Failed to read file data from pack"; return done(false); }
+    out.assign(data + begin, data + begin + entry.size);
+    return done(true);
+}
+
+namespace {
+
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+bool advise_minipack_ranges(const std::string &path, std::span<const MiniPackByteRange> ranges, int advice, std::string &err)
+{
+    // Ranges are grouped by volume; each file is opened once per call
+    int fd = -1;
+    uint32_t fd_volume = 0;
+    for (const MiniPackByteRange &r : ranges) {
+        if (fd < 0 || r.volume != fd_volume) {
+            if (fd >= 0) ::close(fd);
+            const std::string file = r.volume == 0 ? path : minipack_format::volume_path(path, r.volume);
+            fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+            fd_volume = r.volume;
+            if (fd < 0) { err = "Failed to open pack for reading: " + file; return false; }
+        }
+        // The page cache outlives the descriptor, so the hints stay in effect after close
+        ::posix_fadvise(fd, static_cast<off_t>(r.offset), static_cast<off_t>(r.size), advice);
+    }
+    if (fd >= 0) ::close(fd);
+    return true;
+}
+#else
+bool advise_minipack_ranges(const std::string &, std::span<const MiniPackByteRange>, int, std::string &)
+{
+    return true;
+}
+#endif
+
+#if defined(POSIX_FADV_WILLNEED)
+constexpr int kAdviseWillNeed = POSIX_FADV_WILLNEED;
+constexpr int kAdviseDontNeed = POSIX_FADV_DONTNEED;
+#else
+constexpr int kAdviseWillNeed = 0;
+constexpr int kAdviseDontNeed = 0;
+#endif
+
+} // namespace
+
+bool prefetch_minipack_ranges(const std::string &path, std::span<const MiniPackByteRange> ranges, std::string &err)
+{
+    return advise_minipack_ranges(path, ranges, kAdviseWillNeed, err);
+}
+
+bool release_minipack_ranges(const std::string &path, std::span<const MiniPackByteRange> ranges, std::string &err)
+{
+    return advise_minipack_ranges(path, ranges, kAdviseDontNeed, err);
+}
+
+bool prefetch_minipack_entries(const std::string &path, const MiniPackIndex &index, std::span<const MiniPackEntry* const> entries, std::string &err)
+{
+    std::vector<MiniPackByteRange> ranges;
+    index.byte_ranges(entries, ranges, kMiniPackPrefetchMergeGap);
+    return prefetch_minipack_ranges(path, ranges, err);
+}
+
+bool release_minipack_entries(const std::string &path, const MiniPackIndex &index, std::span<const MiniPackEntry* const> entries, std::string &err)
+{
+    // No gap merging: pages between the entries may still be in use
+    std::vector<MiniPackByteRange> ranges;
+    index.byte_ranges(entries, ranges);
+    return release_minipack_ranges(path, ranges, err);
+}
@@ -1,14 +1,42 @@
 ﻿#pragma once
 
 #include "pack_reader.h"
+#include <span>
 #include <string>
 #include <vector>
 
+// Every function takes an optional MiniPackStats (minipack_stats.h) that records
+// counts, bytes and latency; the loaders also attach it to the index for lookups.
+
 // Load an index from a pack file into MiniPackIndex. Returns true on success and sets err on failure.
-bool load_minipack_index(const std::string &path, MiniPackIndex &index, std::string &err);
+bool load_minipack_index(const std::string &path, MiniPackIndex &index, std::string &err, MiniPackStats *stats = nullptr);
+
+// Load an index from a complete pack image held in memory (e.g. MiniPackBuilder::build_pack_image).
+bool load_minipack_index_from_memory(const uint8_t *data, size_t size, MiniPackIndex &index, std::string &err, MiniPackStats *stats = nullptr);
 
 // Read file data by index entry into memory. Returns true on success and fills out buffer.
-bool read_minipack_entry_data(const std::string &path, const MiniPackEntry &entry, std::vector<uint8_t> &out, std::string &err);
+bool read_minipack_entry_data(const std::string &path, const MiniPackEntry &entry, std::vector<uint8_t> &out, std::string &err, MiniPackStats *stats = nullptr);
+
+// Read 'length' bytes starting 'offset' bytes into the entry (e.g. one mip level or
+// audio segment of a large entry); only that window is read from disk.
+bool read_minipack_entry_range(const std::string &path, const MiniPackEntry &entry, uint64_t offset, uint64_t length, std::vector<uint8_t> &out, std::string &err, MiniPackStats *stats = nullptr);
 
 // Extract entry to file path
-bool extract_minipack_entry_to_file(const std::string &path, const MiniPackEntry &entry, const std::string &out_path, std::string &err);
+bool extract_minipack_entry_to_file(const std::string &path, const MiniPackEntry &entry, const std::string &out_path, std::string &err, MiniPackStats *stats = nullptr);
+
+// Copy entry data out of a pack image held in memory. Entries of multi-volume packs
+// live in the volume files and are rejected.
+bool read_minipack_entry_data_from_memory(const uint8_t *data, size_t size, const MiniPackEntry &entry, std::vector<uint8_t> &out, std::string &err, MiniPackStats *stats = nullptr);
+
+// Page-cache hints for byte ranges of a pack file (see MiniPackIndex::byte_ranges).
+// prefetch asks the OS to start reading the ranges ahead of use; release lets it drop
+// their cached pages. Hints are advisory and are no-ops where the platform has no
+// equivalent; false only if the pack cannot be opened.
+bool prefetch_minipack_ranges(const std::string &path, std::span<const MiniPackByteRange> ranges, std::string &err);
+bool release_minipack_ranges(const std::string &path, std::span<const MiniPackByteRange> ranges, std::string &err);
+
+// Same for the data of a set of entries. Prefetch joins ranges up to
+// kMiniPackPrefetchMergeGap apart, so nearby entries become one read-ahead.
+constexpr uint64_t kMiniPackPrefetchMergeGap = 128 * 1024;
+bool prefetch_minipack_entries(const std::string &path, const MiniPackIndex &index, std::span<const MiniPackEntry* const> entries, std::string &err);
+bool release_minipack_entries(const std::string &path, const MiniPackIndex &index, std::span<const MiniPackEntry* const> entries, std::string &err);
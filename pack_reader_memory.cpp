@@ -0,0 +1,248 @@
+﻿#include "pack_reader_memory.h"
+#include "pack_reader_io.h"
+#include "minipack_format.h"
+#include "minipack_stats.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include "utf_conv.h"
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MiniPackMemoryReader::open(std::span<const uint8_t> bytes, std::string &err, MiniPackStats *stats)
+{
+    close();
+    if (!load_minipack_index_from_memory(bytes.data(), bytes.size(), m_index, err, stats)) return false;
+    m_bytes = bytes;
+    m_stats = stats;
+    return true;
+}
+
+void MiniPackMemoryReader::close()
+{
+    m_bytes = {};
+    m_index.clear();
+    m_stats = nullptr;
+}
+
+bool MiniPackMemoryReader::view_entry(const MiniPackEntry &entry, std::span<const uint8_t> &out, std::string &err) const
+{
+    if (entry.volume != 0) { err = "Entry is stored in volume " + std::to_string(entry.volume) + ", not in the pack bytes"; return false; }
+    const uint64_t begin = m_index.data_start() + entry.offset;
+    if (begin > m_bytes.size() || m_bytes.size() - begin < entry.size) { err = "Failed to read file data from pack"; return false; }
+    out = m_bytes.subspan(static_cast<size_t>(begin), entry.size);
+    return true;
+}
+
+bool MiniPackMemoryReader::entry_bytes(const MiniPackEntry &entry, std::span<const uint8_t> &out, std::string &err) const
+{
+    const bool ok = view_entry(entry, out, err);
+    if (m_stats) m_stats->record_read(entry.name, entry.size, ok);
+    return ok;
+}
+
+bool MiniPackMemoryReader::read_entry(const MiniPackEntry &entry, std::vector<uint8_t> &out, std::string &err) const
+{
+    const auto start = MiniPackStats::start();
+    std::span<const uint8_t> view;
+    const bool ok = view_entry(entry, view, err);
+    if (ok) out.assign(view.begin(), view.end());
+    if (m_stats) m_stats->record_read(entry.name, start, entry.size, ok);
+    return ok;
+}
+
+bool MiniPackMemoryReader::entry_range_bytes(const MiniPackEntry &entry, uint64_t offset, uint64_t length, std::span<const uint8_t> &out, std::string &err) const
+{
+    const bool ok = minipack_check_entry_range(entry, offset, length, err) && view_entry(entry, out, err);
+    if (ok) out = out.subspan(static_cast<size_t>(offset), static_cast<size_t>(length));
+    if (m_stats) m_stats->record_read(entry.name, length, ok);
+    return ok;
+}
+
+bool MiniPackMemoryReader::read_entry_range(const MiniPackEntry &entry, uint64_t offset, uint64_t length, std::vector<uint8_t> &out, std::string &err) const
+{
+    const auto start = MiniPackStats::start();
+    std::span<const uint8_t> view;
+    const bool ok = minipack_check_entry_range(entry, offset, length, err) && view_entry(entry, view, err);
+    if (ok) out.assign(view.begin() + static_cast<ptrdiff_t>(offset), view.begin() + static_cast<ptrdiff_t>(offset + length));
+    if (m_stats) m_stats->record_read(entry.name, start, length, ok);
+    return ok;
+}
+
+MiniPackMappedFile::~MiniPackMappedFile()
+{
+    close();
+}
+
+bool MiniPackMappedFile::view_span(const MiniPackByteRange &r, size_t page, uint8_t *&begin, size_t &size) const
+{
+    if (!m_view || r.volume != 0 || r.size == 0 || r.offset >= m_size) return false;
+    const uint64_t base = static_cast<uint64_t>(m_data - static_cast<const uint8_t*>(m_view));
+    const uint64_t first = base + r.offset;
+    const uint64_t last = base + (r.size > m_size - r.offset ? m_size : r.offset + r.size);
+    const uint64_t aligned = first - first % page;
+    begin = static_cast<uint8_t*>(m_view) + aligned;
+    size = static_cast<size_t>(last - aligned);
+    return true;
+}
+
+#ifdef _WIN32
+
+bool MiniPackMappedFile::open(const std::string &path, uint64_t offset, uint64_t size, std::string &err)
+{
+    close();
+    std::u16string wpath;
+    if (!utf8_to_utf16(path, wpath)) { err = "Invalid UTF-8 in pack path: " + path; return false; }
+    HANDLE file = CreateFileW(reinterpret_cast<LPCWSTR>(wpath.c_str()), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) { err = "Failed to open pack file: " + path; return false; }
+
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file, &file_size)) { CloseHandle(file); err = "Failed to stat pack file: " + path; return false; }
+    const uint64_t total = static_cast<uint64_t>(file_size.QuadPart);
+    if (offset > total || (size != 0 && total - offset < size)) { CloseHandle(file); err = "Pack range outside file: " + path; return false; }
+    if (size == 0) size = total - offset;
+    if (size == 0) { CloseHandle(file); err = "Failed to read pack header"; return false; }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) { CloseHandle(file); err = "Failed to map pack file: " + path; return false; }
+
+    SYSTEM_INFO si{};
+    GetSystemInfo(&si);
+    const uint64_t aligned = offset - offset % si.dwAllocationGranularity;
+    const size_t view_size = static_cast<size_t>(size + (offset - aligned));
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(aligned >> 32), static_cast<DWORD>(aligned & 0xFFFFFFFFu), view_size);
+    if (!view) { CloseHandle(mapping); CloseHandle(file); err = "Failed to map pack file: " + path; return false; }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_view = view;
+    m_view_size = view_size;
+    m_data = static_cast<const uint8_t*>(view) + (offset - aligned);
+    m_size = static_cast<size_t>(size);
+    return true;
+}
+
+void MiniPackMappedFile::prefetch(std::span<const MiniPackByteRange> ranges) const
+{
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+    SYSTEM_INFO si{};
+    GetSystemInfo(&si);
+    std::vector<WIN32_MEMORY_RANGE_ENTRY> entries;
+    entries.reserve(ranges.size());
+    for (const MiniPackByteRange &r : ranges) {
+        uint8_t *begin = nullptr;
+        size_t size = 0;
+        if (view_span(r, si.dwPageSize, begin, size)) entries.push_back(WIN32_MEMORY_RANGE_ENTRY{begin, size});
+    }
+    if (!entries.empty()) PrefetchVirtualMemory(GetCurrentProcess(), entries.size(), entries.data(), 0);
+#else
+    (void)ranges;
+#endif
+}
+
+void MiniPackMappedFile::release(std::span<const MiniPackByteRange> ranges) const
+{
+    SYSTEM_INFO si{};
+    GetSystemInfo(&si);
+    for (const MiniPackByteRange &r : ranges) {
+        uint8_t *begin = nullptr;
+        size_t size = 0;
+        // Unlocking pages that are not locked removes them from the working set
+        if (view_span(r, si.dwPageSize, begin, size)) VirtualUnlock(begin, size);
+    }
+}
+
+void MiniPackMappedFile::close()
+{
+    if (m_view) UnmapViewOfFile(m_view);
+    if (m_mapping) CloseHandle(static_cast<HANDLE>(m_mapping));
+    if (m_file) CloseHandle(static_cast<HANDLE>(m_file));
+    m_view = nullptr;
+    m_mapping = nullptr;
+    m_file = nullptr;
+    m_view_size = 0;
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#else
+
+bool MiniPackMappedFile::open(const std::string &path, uint64_t offset, uint64_t size, std::string &err)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { err = "Failed to open pack file: " + path + " (" + std::strerror(errno) + ")"; return false; }
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) { ::close(fd); err = "Failed to stat pack file: " + path; return false; }
+    const uint64_t total = static_cast<uint64_t>(st.st_size);
+    if (offset > total || (size != 0 && total - offset < size)) { ::close(fd); err = "Pack range outside file: " + path; return false; }
+    if (size == 0) size = total - offset;
+    if (size == 0) { ::close(fd); err = "Failed to read pack header"; return false; }
+
+    const uint64_t page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    const uint64_t aligned = offset - offset % page;
+    const size_t view_size = static_cast<size_t>(size + (offset - aligned));
+    void *view = ::mmap(nullptr, view_size, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(aligned));
+    if (view == MAP_FAILED) { ::close(fd); err = "Failed to map pack file: " + path + " (" + std::strerror(errno) + ")"; return false; }
+
+    m_fd = fd;
+    m_view_offset = aligned;
+    m_view = view;
+    m_view_size = view_size;
+    m_data = static_cast<const uint8_t*>(view) + (offset - aligned);
+    m_size = static_cast<size_t>(size);
+    return true;
+}
+
+void MiniPackMappedFile::prefetch(std::span<const MiniPackByteRange> ranges) const
+{
+    const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    for (const MiniPackByteRange &r : ranges) {
+        uint8_t *begin = nullptr;
+        size_t size = 0;
+        if (view_span(r, page, begin, size)) ::madvise(begin, size, MADV_WILLNEED);
+    }
+}
+
+void MiniPackMappedFile::release(std::span<const MiniPackByteRange> ranges) const
+{
+    // The mapping is shared and read-only, so dropped pages are simply re-read from the file.
+    // MADV_DONTNEED only unmaps them from this process; the fadvise evicts the now
+    // unmapped pages from the page cache.
+    const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    for (const MiniPackByteRange &r : ranges) {
+        uint8_t *begin = nullptr;
+        size_t size = 0;
+        if (!view_span(r, page, begin, size)) continue;
+        ::madvise(begin, size, MADV_DONTNEED);
+#if defined(POSIX_FADV_DONTNEED)
+        const uint64_t file_offset = m_view_offset + static_cast<uint64_t>(begin - static_cast<uint8_t*>(m_view));
+        ::posix_fadvise(m_fd, static_cast<off_t>(file_offset), static_cast<off_t>(size), POSIX_FADV_DONTNEED);
+#endif
+    }
+}
+
+void MiniPackMappedFile::close()
+{
+    if (m_view) ::munmap(m_view, m_view_size);
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = -1;
+    m_view_offset = 0;
+    m_view = nullptr;
+    m_view_size = 0;
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#endif
@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include "pack_reader.h"
+#include "pack_reader_views.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Zero-copy reader over a pack that is already in memory: an embedded resource,
+// a shared memory segment, a MiniPackImage or a mapped file range.
+// The caller keeps the bytes alive for as long as the reader is used.
+class MiniPackMemoryReader {
+public:
+    MiniPackMemoryReader() = default;
+
+    // Parse the index from 'bytes', which must start with the pack header.
+    // 'stats' (optional, minipack_stats.h) records the load, lookups and every read.
+    bool open(std::span<const uint8_t> bytes, std::string &err, MiniPackStats *stats = nullptr);
+    void close();
+
+    bool is_open() const { return m_bytes.data() != nullptr; }
+
+    const MiniPackIndex &index() const { return m_index; }
+    std::span<const uint8_t> bytes() const { return m_bytes; }
+
+    // View of an entry's data inside the pack bytes; no copy is made.
+    bool entry_bytes(const MiniPackEntry &entry, std::span<const uint8_t> &out, std::string &err) const;
+
+    // Typed view of a POD array entry (see add_entry_from_array); no copy is made.
+    template<typename T>
+    bool entry_as(const MiniPackEntry &entry, std::span<const T> &out, std::string &err) const
+    {
+        std::span<const uint8_t> bytes;
+        return entry_bytes(entry, bytes, err) && minipack_view_as(bytes, out, err);
+    }
+
+    // String view list over an entry written by write_string_list; no copy is made.
+    bool entry_string_list(const MiniPackEntry &entry, MiniPackStringList &out, std::string &err) const
+    {
+        std::span<const uint8_t> bytes;
+        return entry_bytes(entry, bytes, err) && out.open(bytes, err);
+    }
+
+    // Copy an entry's data into 'out'.
+    bool read_entry(const MiniPackEntry &entry, std::vector<uint8_t> &out, std::string &err) const;
+
+    // Sub-range of an entry ('length' bytes from 'offset'), as a view or a copy.
+    bool entry_range_bytes(const MiniPackEntry &entry, uint64_t offset, uint64_t length, std::span<const uint8_t> &out, std::string &err) const;
+    bool read_entry_range(const MiniPackEntry &entry, uint64_t offset, uint64_t length, std::vector<uint8_t> &out, std::string &err) const;
+
+private:
+    bool view_entry(const MiniPackEntry &entry, std::span<const uint8_t> &out, std::string &err) const;
+
+    std::span<const uint8_t> m_bytes;
+    MiniPackIndex m_index;
+    MiniPackStats *m_stats = nullptr;
+};
+
+// Read-only mapping of a file, or of a byte range inside it, so a pack stored at
+// an offset inside a larger file (e.g. appended to an executable) can be read in place.
+class MiniPackMappedFile {
+public:
+    MiniPackMappedFile() = default;
+    ~MiniPackMappedFile();
+
+    MiniPackMappedFile(const MiniPackMappedFile &) = delete;
+    MiniPackMappedFile &operator=(const MiniPackMappedFile &) = delete;
+
+    // Map 'size' bytes starting at 'offset'; size 0 maps through to the end of the file.
+    bool open(const std::string &path, uint64_t offset, uint64_t size, std::string &err);
+    bool open(const std::string &path, std::string &err) { return open(path, 0, 0, err); }
+    void close();
+
+    std::span<const uint8_t> bytes() const { return {m_data, m_size}; }
+
+    // Page-cache hints for ranges of the mapping (relative to bytes(), e.g. from
+    // MiniPackIndex::byte_ranges): prefetch starts paging them in. release unmaps the
+    // pages from this process and, on POSIX, asks the kernel to evict them from the
+    // page cache (pages still mapped by other processes stay); on Windows only the
+    // working set is trimmed. Released pages are read back from the file on next
+    // access. Advisory; ranges in volume files are skipped.
+    void prefetch(std::span<const MiniPackByteRange> ranges) const;
+    void release(std::span<const MiniPackByteRange> ranges) const;
+
+private:
+    // Page-aligned span of the view covering 'r', clipped to the mapping; false if empty
+    bool view_span(const MiniPackByteRange &r, size_t page, uint8_t *&begin, size_t &size) const;
+
+    const uint8_t *m_data = nullptr; // start of the requested range
+    size_t m_size = 0;
+    void *m_view = nullptr;          // page/granularity aligned mapping base
+    size_t m_view_size = 0;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#else
+    int m_fd = -1;                   // kept open for posix_fadvise in release()
+    uint64_t m_view_offset = 0;      // file offset of m_view
+#endif
+};
@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "minipack_format.h"
+
+// Zero-copy views over entry bytes, the reader-side counterparts of
+// MiniPackBuilder::add_entry_from_array and write_string_list. The views
+// reference the bytes they were created from and never allocate.
+
+// View 'bytes' as an array of T. Fails if the size is not a multiple of sizeof(T)
+// or the data is not aligned for T (build with MiniPackBuilder::set_entry_alignment).
+template<typename T>
+bool minipack_view_as(std::span<const uint8_t> bytes, std::span<const T> &out, std::string &err)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "entry views need a trivially copyable type");
+    if (bytes.size() % sizeof(T) != 0) { err = "Entry size is not a multiple of the element size"; return false; }
+    if (reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(T) != 0) { err = "Entry data misaligned for requested type"; return false; }
+    out = std::span<const T>(reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T));
+    return true;
+}
+
+// View over the write_string_list layout:
+//   u32 count, u8 lengths[count], then each string followed by a NUL.
+class MiniPackStringList {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = std::string_view;
+
+        iterator() = default;
+        iterator(const uint8_t *lengths, const char *text, uint32_t index) : m_lengths(lengths), m_text(text), m_index(index) {}
+
+        std::string_view operator*() const { return std::string_view(m_text, m_lengths[m_index]); }
+        iterator &operator++() { m_text += m_lengths[m_index] + 1; ++m_index; return *this; }
+        iterator operator++(int) { iterator t = *this; ++*this; return t; }
+        bool operator==(const iterator &o) const { return m_index == o.m_index; }
+
+    private:
+        const uint8_t *m_lengths = nullptr;
+        const char *m_text = nullptr; // start of the current string
+        uint32_t m_index = 0;
+    };
+
+    MiniPackStringList() = default;
+
+    // Validate the layout once so iteration needs no further checks.
+    bool open(std::span<const uint8_t> bytes, std::string &err)
+    {
+        *this = MiniPackStringList();
+        size_t pos = 0;
+        uint32_t count = 0;
+        if (!minipack_format::read_u32_le(bytes.data(), bytes.size(), pos, count)) { err = "String list corrupted (count)"; return false; }
+        if (bytes.size() - pos < count) { err = "String list corrupted (lengths)"; return false; }
+        const uint8_t *lengths = bytes.data() + pos;
+        pos += count;
+        const size_t text_begin = pos;
+        for (uint32_t i = 0; i < count; ++i) {
+            pos += lengths[i];
+            if (pos >= bytes.size() || bytes[pos] != 0) { err = "String list corrupted (strings)"; return false; }
+            ++pos;
+        }
+        m_lengths = lengths;
+        m_text = reinterpret_cast<const char*>(bytes.data() + text_begin);
+        m_count = count;
+        return true;
+    }
+
+    uint32_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+
+    iterator begin() const { return iterator(m_lengths, m_text, 0); }
+    iterator end() const { return iterator(m_lengths, nullptr, m_count); }
+
+private:
+    const uint8_t *m_lengths = nullptr;
+    const char *m_text = nullptr;
+    uint32_t m_count = 0;
+};
@@ -1,7 +1,9 @@
 ﻿#include "utf_conv.h"
+#include "utf_simd.h"
 
 #include <vector>
 #include <functional>
+#include <bit>
 
 static inline uint16_t read_u16_le(const uint8_t* p) { return static_cast<uint16_t>(p[0]) | (static_cast<uint16_t>(p[1]) << 8); }
 static inline uint16_t read_u16_be(const uint8_t* p) { return static_cast<uint16_t>(p[0]) << 8 | static_cast<uint16_t>(p[1]); }
@@ -47,15 +49,15 @@ static bool convert_utf16(const uint8_t* data, size_t size, std::function<uint16
     return true;
 }
 
-bool utf16le_bytes_to_utf8(const uint8_t* data, size_t size, std::string &out) {
+bool utf16le_bytes_to_utf8_scalar(const uint8_t* data, size_t size, std::string &out) {
     return convert_utf16(data, size, [](const uint8_t* p){ return read_u16_le(p); }, out);
 }
 
-bool utf16be_bytes_to_utf8(const uint8_t* data, size_t size, std::string &out) {
+bool utf16be_bytes_to_utf8_scalar(const uint8_t* data, size_t size, std::string &out) {
     return convert_utf16(data, size, [](const uint8_t* p){ return read_u16_be(p); }, out);
 }
 
-bool utf16_string_to_utf8(const std::u16string &in, std::string &out) {
+bool utf16_string_to_utf8_scalar(const std::u16string &in, std::string &out) {
     out.clear();
     out.reserve(in.size());
     size_t i = 0;
@@ -76,3 +78,87 @@ bool utf16_string_to_utf8(const std::u16string &in, std::string &out) {
     }
     return true;
 }
+
+// ---- fast paths -----------------------------------------------------------
+// ASCII runs go through the dispatched SIMD kernels; everything else is decoded
+// exactly like the scalar converters above, writing into a pre-sized buffer.
+
+static size_t encode_utf8(char *dst, uint32_t cp) {
+    if (cp <= 0x7F) {
+        dst[0] = static_cast<char>(cp);
+        return 1;
+    } else if (cp <= 0x7FF) {
+        dst[0] = static_cast<char>(0xC0 | ((cp >> 6) & 0x1F));
+        dst[1] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 2;
+    } else if (cp <= 0xFFFF) {
+        dst[0] = static_cast<char>(0xE0 | ((cp >> 12) & 0x0F));
+        dst[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        dst[2] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    dst[0] = static_cast<char>(0xF0 | ((cp >> 18) & 0x07));
+    dst[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    dst[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    dst[3] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+template<bool BigEndian>
+static bool convert_utf16_fast(const uint8_t* data, size_t size, std::string &out) {
+    if (size % 2 != 0) return false;
+    out.clear();
+    const size_t units = size / 2;
+    if (units == 0) return true;
+
+    const auto &k = minipack_utf_simd::kernels();
+    const auto narrow = BigEndian ? k.narrow_u16be : k.narrow_u16le;
+    auto reader = [](const uint8_t* p) { return BigEndian ? read_u16_be(p) : read_u16_le(p); };
+
+    // At most 3 UTF-8 bytes per UTF-16 unit (a surrogate pair yields 4 for 2 units)
+    out.resize(units * 3);
+    char *dst = out.data();
+    size_t o = 0;
+    size_t i = 0;
+    while (i < units) {
+        const size_t n = narrow(data + 2 * i, units - i, dst + o);
+        i += n;
+        o += n;
+        while (i < units) {
+            const uint16_t w1 = reader(data + 2 * i);
+            if (w1 < 0x80) break;
+            ++i;
+            if (w1 >= 0xD800 && w1 <= 0xDBFF) {
+                if (i >= units) { out.resize(o); return false; }
+                const uint16_t w2 = reader(data + 2 * i);
+                ++i;
+                if (w2 < 0xDC00 || w2 > 0xDFFF) { out.resize(o); return false; }
+                o += encode_utf8(dst + o, 0x10000 + (((w1 - 0xD800) << 10) | (w2 - 0xDC00)));
+            } else if (w1 >= 0xDC00 && w1 <= 0xDFFF) {
+                out.resize(o);
+                return false;
+            } else {
+                o += encode_utf8(dst + o, w1);
+            }
+        }
+    }
+    out.resize(o);
+    return true;
+}
+
+bool utf16le_bytes_to_utf8(const uint8_t* data, size_t size, std::string &out) {
+    return convert_utf16_fast<false>(data, size, out);
+}
+
+bool utf16be_bytes_to_utf8(const uint8_t* data, size_t size, std::string &out) {
+    return convert_utf16_fast<true>(data, size, out);
+}
+
+bool utf16_string_to_utf8(const std::u16string &in, std::string &out) {
+    // char16_t storage is host-endian; reuse the byte converters on it directly
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(in.data());
+    if constexpr (std::endian::native == std::endian::big)
+        return convert_utf16_fast<true>(bytes, in.size() * 2, out);
+    else
+        return convert_utf16_fast<false>(bytes, in.size() * 2, out);
+}
@@ -1,4 +1,5 @@
 ﻿#include "utf_conv.h"
+#include "utf_simd.h"
 #include <cstdint>
 #include <functional>
 #include <cstddef>
@@ -40,10 +41,67 @@ static bool convert_utf32(const uint8_t* data, size_t size, std::function<uint32
     return true;
 }
 
-bool utf32le_bytes_to_utf8(const uint8_t* data, size_t size, std::string &out) {
+bool utf32le_bytes_to_utf8_scalar(const uint8_t* data, size_t size, std::string &out) {
     return convert_utf32(data, size, [](const uint8_t* p){ return read_u32_le(p); }, out);
 }
 
-bool utf32be_bytes_to_utf8(const uint8_t* data, size_t size, std::string &out) {
+bool utf32be_bytes_to_utf8_scalar(const uint8_t* data, size_t size, std::string &out) {
     return convert_utf32(data, size, [](const uint8_t* p){ return read_u32_be(p); }, out);
 }
+
+// ---- fast paths -----------------------------------------------------------
+// ASCII runs go through the dispatched SIMD kernels; other code points are
+// validated exactly like convert_utf32 above.
+
+template<bool BigEndian>
+static bool convert_utf32_fast(const uint8_t* data, size_t size, std::string &out) {
+    if (size % 4 != 0) return false;
+    out.clear();
+    const size_t units = size / 4;
+    if (units == 0) return true;
+
+    const auto &k = minipack_utf_simd::kernels();
+    const auto narrow = BigEndian ? k.narrow_u32be : k.narrow_u32le;
+
+    out.resize(units * 4);
+    char *dst = out.data();
+    size_t o = 0;
+    size_t i = 0;
+    while (i < units) {
+        const size_t n = narrow(data + 4 * i, units - i, dst + o);
+        i += n;
+        o += n;
+        while (i < units) {
+            const uint32_t cp = BigEndian ? read_u32_be(data + 4 * i) : read_u32_le(data + 4 * i);
+            if (cp < 0x80) break;
+            ++i;
+            if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+                out.resize(o);
+                return false;
+            }
+            if (cp <= 0x7FF) {
+                dst[o++] = static_cast<char>(0xC0 | ((cp >> 6) & 0x1F));
+                dst[o++] = static_cast<char>(0x80 | (cp & 0x3F));
+            } else if (cp <= 0xFFFF) {
+                dst[o++] = static_cast<char>(0xE0 | ((cp >> 12) & 0x0F));
+                dst[o++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                dst[o++] = static_cast<char>(0x80 | (cp & 0x3F));
+            } else {
+                dst[o++] = static_cast<char>(0xF0 | ((cp >> 18) & 0x07));
+                dst[o++] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                dst[o++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                dst[o++] = static_cast<char>(0x80 | (cp & 0x3F));
+            }
+        }
+    }
+    out.resize(o);
+    return true;
+}
+
+bool utf32le_bytes_to_utf8(const uint8_t* data, size_t size, std::string &out) {
+    return convert_utf32_fast<false>(data, size, out);
+}
+
+bool utf32be_bytes_to_utf8(const uint8_t* data, size_t size, std::string &out) {
+    return convert_utf32_fast<true>(data, size, out);
+}
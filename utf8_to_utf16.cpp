@@ -1,9 +1,10 @@
 ﻿#include "utf_conv.h"
+#include "utf_simd.h"
 
 #include <string>
 #include <cstdint>
 
-bool utf8_to_utf16(const std::string &utf8, std::u16string &out)
+bool utf8_to_utf16_scalar(const std::string &utf8, std::u16string &out)
 {
     out.clear();
     if (utf8.empty()) return true;
@@ -75,3 +76,82 @@ bool utf8_to_utf16(const std::string &utf8, std::u16string &out)
 
     return true;
 }
+
+// Decode one multi-byte sequence starting at src[i] (src[i] >= 0x80) with the
+// same checks as the scalar converter. Returns the sequence length, 0 on error.
+static size_t decode_utf8_multibyte(const uint8_t *src, size_t len, size_t i, uint32_t &codepoint)
+{
+    const uint8_t b0 = src[i];
+    size_t extra = 0;
+    if ((b0 & 0xE0) == 0xC0) {
+        if (b0 < 0xC2) return 0; // overlong
+        codepoint = b0 & 0x1F;
+        extra = 1;
+    } else if ((b0 & 0xF0) == 0xE0) {
+        codepoint = b0 & 0x0F;
+        extra = 2;
+    } else if ((b0 & 0xF8) == 0xF0) {
+        if (b0 > 0xF4) return 0; // > U+10FFFF
+        codepoint = b0 & 0x07;
+        extra = 3;
+    } else {
+        return 0; // invalid leading byte
+    }
+
+    if (i + extra >= len) return 0; // truncated
+
+    for (size_t k = 1; k <= extra; ++k) {
+        const uint8_t bx = src[i + k];
+        if ((bx & 0xC0) != 0x80) return 0; // invalid continuation
+        codepoint = (codepoint << 6) | (bx & 0x3F);
+    }
+
+    static const uint32_t kMinCodepoint[4] = {0, 0x80, 0x800, 0x10000};
+    if (codepoint < kMinCodepoint[extra]) return 0; // overlong
+    if (codepoint >= 0xD800 && codepoint <= 0xDFFF) return 0;
+    if (codepoint > 0x10FFFF) return 0;
+    return 1 + extra;
+}
+
+bool utf8_to_utf16(const std::string &utf8, std::u16string &out)
+{
+    out.clear();
+    if (utf8.empty()) return true;
+
+    const size_t len = utf8.size();
+    const uint8_t *src = reinterpret_cast<const uint8_t*>(utf8.data());
+    const auto &k = minipack_utf_simd::kernels();
+
+    // Never more UTF-16 units than UTF-8 bytes
+    out.resize(len);
+    char16_t *dst = out.data();
+    size_t o = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        const size_t n = k.widen_ascii(src + i, len - i, dst + o);
+        i += n;
+        o += n;
+
+        // Decode the non-ASCII run one code point at a time
+        while (i < len && src[i] >= 0x80) {
+            uint32_t codepoint = 0;
+            const size_t used = decode_utf8_multibyte(src, len, i, codepoint);
+            if (used == 0) {
+                out.resize(o);
+                return false;
+            }
+            if (codepoint <= 0xFFFF) {
+                dst[o++] = static_cast<char16_t>(codepoint);
+            } else {
+                const uint32_t cp = codepoint - 0x10000;
+                dst[o++] = static_cast<char16_t>(0xD800 + ((cp >> 10) & 0x3FF));
+                dst[o++] = static_cast<char16_t>(0xDC00 + (cp & 0x3FF));
+            }
+            i += used;
+        }
+    }
+
+    out.resize(o);
+    return true;
+}
@@ -0,0 +1,287 @@
+﻿#include "utf_simd.h"
+
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MINIPACK_UTF_X86_64 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(MINIPACK_UTF_X86_64) && (defined(__GNUC__) || defined(__clang__))
+#define MINIPACK_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MINIPACK_TARGET_AVX2
+#endif
+
+namespace minipack_utf_simd {
+namespace {
+
+// ---- scalar -------------------------------------------------------------
+
+std::size_t ascii_prefix_scalar(const std::uint8_t *src, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        std::uint64_t w;
+        std::memcpy(&w, src + i, 8);
+        if (w & 0x8080808080808080ull) break;
+    }
+    while (i < n && src[i] < 0x80) ++i;
+    return i;
+}
+
+std::size_t widen_ascii_scalar(const std::uint8_t *src, std::size_t n, char16_t *dst)
+{
+    std::size_t i = 0;
+    while (i < n && src[i] < 0x80) {
+        dst[i] = static_cast<char16_t>(src[i]);
+        ++i;
+    }
+    return i;
+}
+
+template<bool BigEndian>
+std::size_t narrow_u16_scalar(const std::uint8_t *src, std::size_t units, char *dst)
+{
+    std::size_t i = 0;
+    for (; i < units; ++i) {
+        const std::uint8_t hi = BigEndian ? src[2 * i] : src[2 * i + 1];
+        const std::uint8_t lo = BigEndian ? src[2 * i + 1] : src[2 * i];
+        if (hi != 0 || lo >= 0x80) break;
+        dst[i] = static_cast<char>(lo);
+    }
+    return i;
+}
+
+template<bool BigEndian>
+std::size_t narrow_u32_scalar(const std::uint8_t *src, std::size_t units, char *dst)
+{
+    std::size_t i = 0;
+    for (; i < units; ++i) {
+        const std::uint8_t *p = src + 4 * i;
+        const std::uint8_t lo = BigEndian ? p[3] : p[0];
+        const bool high_zero = BigEndian ? (p[0] | p[1] | p[2]) == 0 : (p[1] | p[2] | p[3]) == 0;
+        if (!high_zero || lo >= 0x80) break;
+        dst[i] = static_cast<char>(lo);
+    }
+    return i;
+}
+
+const Kernels kScalar = {
+    "scalar",
+    ascii_prefix_scalar,
+    widen_ascii_scalar,
+    narrow_u16_scalar<false>,
+    narrow_u16_scalar<true>,
+    narrow_u32_scalar<false>,
+    narrow_u32_scalar<true>,
+};
+
+#if defined(MINIPACK_UTF_X86_64)
+
+// ---- SSE2 (baseline on x86-64) -----------------------------------------
+
+std::size_t ascii_prefix_sse2(const std::uint8_t *src, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const unsigned m = static_cast<unsigned>(_mm_movemask_epi8(v));
+        if (m) return i + static_cast<std::size_t>(std::countr_zero(m));
+    }
+    return i + ascii_prefix_scalar(src + i, n - i);
+}
+
+std::size_t widen_ascii_sse2(const std::uint8_t *src, std::size_t n, char16_t *dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_movemask_epi8(v)) break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+    return i + widen_ascii_scalar(src + i, n - i, dst + i);
+}
+
+template<bool BigEndian>
+std::size_t narrow_u16_sse2(const std::uint8_t *src, std::size_t units, char *dst)
+{
+    // Lanes are loaded little-endian; an ASCII unit has only the low 7 bits set
+    const __m128i mask = _mm_set1_epi16(static_cast<short>(BigEndian ? 0x80FF : 0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 16 <= units; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 16));
+        const __m128i bad = _mm_and_si128(_mm_or_si128(a, b), mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(bad, zero)) != 0xFFFF) break;
+        if (BigEndian) {
+            a = _mm_srli_epi16(a, 8);
+            b = _mm_srli_epi16(b, 8);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a, b));
+    }
+    return i + narrow_u16_scalar<BigEndian>(src + 2 * i, units - i, dst + i);
+}
+
+template<bool BigEndian>
+std::size_t narrow_u32_sse2(const std::uint8_t *src, std::size_t units, char *dst)
+{
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(BigEndian ? 0x80FFFFFFu : 0xFFFFFF80u));
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 8 <= units; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i + 16));
+        const __m128i bad = _mm_and_si128(_mm_or_si128(a, b), mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(bad, zero)) != 0xFFFF) break;
+        if (BigEndian) {
+            a = _mm_srli_epi32(a, 24);
+            b = _mm_srli_epi32(b, 24);
+        }
+        const __m128i p16 = _mm_packs_epi32(a, b);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(p16, p16));
+    }
+    return i + narrow_u32_scalar<BigEndian>(src + 4 * i, units - i, dst + i);
+}
+
+const Kernels kSse2 = {
+    "sse2",
+    ascii_prefix_sse2,
+    widen_ascii_sse2,
+    narrow_u16_sse2<false>,
+    narrow_u16_sse2<true>,
+    narrow_u32_sse2<false>,
+    narrow_u32_sse2<true>,
+};
+
+// ---- AVX2 (runtime dispatched) -----------------------------------------
+
+MINIPACK_TARGET_AVX2 std::size_t ascii_prefix_avx2(const std::uint8_t *src, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const unsigned m = static_cast<unsigned>(_mm256_movemask_epi8(v));
+        if (m) return i + static_cast<std::size_t>(std::countr_zero(m));
+    }
+    return i + ascii_prefix_sse2(src + i, n - i);
+}
+
+MINIPACK_TARGET_AVX2 std::size_t widen_ascii_avx2(const std::uint8_t *src, std::size_t n, char16_t *dst)
+{
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        if (_mm256_movemask_epi8(v)) break;
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+    }
+    return i + widen_ascii_sse2(src + i, n - i, dst + i);
+}
+
+template<bool BigEndian>
+MINIPACK_TARGET_AVX2 std::size_t narrow_u16_avx2(const std::uint8_t *src, std::size_t units, char *dst)
+{
+    const __m256i mask = _mm256_set1_epi16(static_cast<short>(BigEndian ? 0x80FF : 0xFF80));
+    const __m256i zero = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 32 <= units; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i + 32));
+        const __m256i bad = _mm256_and_si256(_mm256_or_si256(a, b), mask);
+        if (static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(bad, zero))) != 0xFFFFFFFFu) break;
+        if (BigEndian) {
+            a = _mm256_srli_epi16(a, 8);
+            b = _mm256_srli_epi16(b, 8);
+        }
+        // packus works per 128-bit lane; restore a_lo, a_hi, b_lo, b_hi order
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    return i + narrow_u16_sse2<BigEndian>(src + 2 * i, units - i, dst + i);
+}
+
+const Kernels kAvx2 = {
+    "avx2",
+    ascii_prefix_avx2,
+    widen_ascii_avx2,
+    narrow_u16_avx2<false>,
+    narrow_u16_avx2<true>,
+    narrow_u32_sse2<false>,
+    narrow_u32_sse2<true>,
+};
+
+bool cpu_has_avx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) return false;
+    __cpuid(r, 1);
+    const bool osxsave = (r[2] & (1 << 27)) != 0;
+    const bool avx = (r[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    if ((_xgetbv(0) & 0x6) != 0x6) return false; // OS saves XMM/YMM state
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // MINIPACK_UTF_X86_64
+
+const Kernels *detect_kernels()
+{
+#if defined(MINIPACK_UTF_X86_64)
+    if (cpu_has_avx2()) return &kAvx2;
+    return &kSse2;
+#else
+    return &kScalar;
+#endif
+}
+
+std::atomic<const Kernels*> g_active{nullptr};
+
+} // namespace
+
+const Kernels &kernels()
+{
+    const Kernels *k = g_active.load(std::memory_order_acquire);
+    if (!k) {
+        k = detect_kernels();
+        g_active.store(k, std::memory_order_release);
+    }
+    return *k;
+}
+
+const Kernels &scalar_kernels()
+{
+    return kScalar;
+}
+
+std::vector<const Kernels*> available_kernels()
+{
+    std::vector<const Kernels*> out{&kScalar};
+#if defined(MINIPACK_UTF_X86_64)
+    out.push_back(&kSse2);
+    if (cpu_has_avx2()) out.push_back(&kAvx2);
+#endif
+    return out;
+}
+
+void force_kernels(const Kernels *k)
+{
+    g_active.store(k ? k : detect_kernels(), std::memory_order_release);
+}
+
+} // namespace minipack_utf_simd
@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Internal ASCII fast-path kernels used by the UTF converters.
+// Each kernel converts the longest all-ASCII prefix of its input and returns
+// the number of code units consumed; the caller handles the first non-ASCII
+// unit with the scalar decoder and then resumes the fast path.
+// The implementation is chosen once at runtime (AVX2, SSE2 or scalar).
+
+namespace minipack_utf_simd {
+
+struct Kernels
+{
+    const char *name;
+    // Length of the leading run of bytes < 0x80
+    std::size_t (*ascii_prefix)(const std::uint8_t *src, std::size_t n);
+    // Widen leading ASCII bytes into UTF-16 code units
+    std::size_t (*widen_ascii)(const std::uint8_t *src, std::size_t n, char16_t *dst);
+    // Narrow leading ASCII UTF-16LE / UTF-16BE units (given as raw bytes, 'units' units)
+    std::size_t (*narrow_u16le)(const std::uint8_t *src, std::size_t units, char *dst);
+    std::size_t (*narrow_u16be)(const std::uint8_t *src, std::size_t units, char *dst);
+    // Narrow leading ASCII UTF-32LE / UTF-32BE units
+    std::size_t (*narrow_u32le)(const std::uint8_t *src, std::size_t units, char *dst);
+    std::size_t (*narrow_u32be)(const std::uint8_t *src, std::size_t units, char *dst);
+};
+
+// Kernels selected for the running CPU.
+const Kernels &kernels();
+
+// Portable kernels, always available.
+const Kernels &scalar_kernels();
+
+// All kernel sets the running CPU supports, scalar first.
+std::vector<const Kernels*> available_kernels();
+
+// Override the active kernel set (nullptr restores detection). Intended for
+// equivalence checks and benchmarks; not safe while conversions are running.
+void force_kernels(const Kernels *k);
+
+} // namespace minipack_utf_simd
+
+// Reference one-code-point-at-a-time converters. Behavior (return value and
+// output, including partial output on failure) is the contract the fast paths
+// in utf_conv.h must match exactly.
+bool utf8_to_utf16_scalar(const std::string &utf8, std::u16string &out);
+bool utf16le_bytes_to_utf8_scalar(const uint8_t* data, size_t size, std::string &out);
+bool utf16be_bytes_to_utf8_scalar(const uint8_t* data, size_t size, std::string &out);
+bool utf32le_bytes_to_utf8_scalar(const uint8_t* data, size_t size, std::string &out);
+bool utf32be_bytes_to_utf8_scalar(const uint8_t* data, size_t size, std::string &out);
+bool utf16_string_to_utf8_scalar(const std::u16string &in, std::string &out);